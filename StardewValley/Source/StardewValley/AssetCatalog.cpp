@@ -0,0 +1,131 @@
+/*****************************************************************//**
+ * \file   AssetCatalog.cpp
+ * \brief  The implementation of the asset catalog
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "AssetCatalog.h"
+#include "Engine/Texture2D.h"
+
+void UAssetCatalog::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	is_preloaded_ = false;
+	assets_.Init(nullptr, static_cast<int32>(EAssetKey::Num));
+	paths_.SetNum(static_cast<int32>(EAssetKey::Num));
+
+	AddAsset(EAssetKey::GrassGroundClass, TEXT("/Game/GroundBlock/BP_GrassGround.BP_GrassGround_C"));
+	AddAsset(EAssetKey::EarthGroundClass, TEXT("/Game/GroundBlock/BP_EarthGround.BP_EarthGround_C"));
+	AddAsset(EAssetKey::FieldGroundClass, TEXT("/Game/GroundBlock/BP_FieldGround.BP_FieldGround_C"));
+	AddAsset(EAssetKey::SnowGroundClass, TEXT("/Game/GroundBlock/BP_SnowGround.BP_SnowGround_C"));
+	AddAsset(EAssetKey::WaterGroundClass, TEXT("/Game/GroundBlock/BP_WaterGround.BP_WaterGround_C"));
+	AddAsset(EAssetKey::TreeBlockClass, TEXT("/Game/ItemBlock/BP_item_block_tree.BP_item_block_tree_C"));
+	AddAsset(EAssetKey::TransparentWallBlockClass, TEXT("/Game/ItemBlock/BP_item_block_transparent_wall.BP_item_block_transparent_wall_C"));
+	AddAsset(EAssetKey::WheatCropBlockClass, TEXT("/Game/ItemBlock/BP_crop/BP_item_block_crop_wheat.BP_item_block_crop_wheat_C"));
+	AddAsset(EAssetKey::MyCharacterClass, TEXT("/Game/Character/BP_MyCharacter.BP_MyCharacter_C"));
+	AddAsset(EAssetKey::NPCCharacterClass, TEXT("/Game/Character/BP_NPC_Character.BP_NPC_Character_C"));
+	AddAsset(EAssetKey::MenuWidgetClass, TEXT("/Game/UMG/WBP_Menu.WBP_Menu_C"));
+	AddAsset(EAssetKey::ShortcutWidgetClass, TEXT("/Game/UMG/WBP_Shortcut.WBP_Shortcut_C"));
+	AddAsset(EAssetKey::MissingIcon, TEXT("/Game/Asset/Icon/Ico_Test_4oD.Ico_Test_4oD"));
+	AddAsset(EAssetKey::EmptyShortcutIcon, TEXT("/Game/Asset/Icon/Ico_Axe_Level1.Ico_Axe_Level1"));
+	for (int32 level = 1; level <= kMaxSkillLevel; level++)
+	{
+		int32 offset = level - 1;
+		AddAsset(static_cast<EAssetKey>(static_cast<int32>(EAssetKey::AxeIcon1) + offset), *FString::Printf(TEXT("/Game/Asset/Icon/Ico_Item_Aex_Level%d.Ico_Item_Aex_Level%d"), level, level));
+		AddAsset(static_cast<EAssetKey>(static_cast<int32>(EAssetKey::HoeIcon1) + offset), *FString::Printf(TEXT("/Game/Asset/Icon/Ico_Item_Hoe_Level%d.Ico_Item_Hoe_Level%d"), level, level));
+		AddAsset(static_cast<EAssetKey>(static_cast<int32>(EAssetKey::ScytheIcon1) + offset), *FString::Printf(TEXT("/Game/Asset/Icon/Ico_Item_Scythe_Level%d.Ico_Item_Scythe_Level%d"), level, level));
+	}
+
+	//Every key must have a path
+	for (int32 i = 0; i < paths_.Num(); i++)
+	{
+		if (paths_[i].IsNull())UE_LOG(LogTemp, Error, TEXT("AssetCatalog.cpp: Initialize: No path for asset key %d"), i);
+	}
+
+	preload_handle_ = streamable_manager_.RequestAsyncLoad(paths_, FStreamableDelegate::CreateUObject(this, &UAssetCatalog::OnPreloaded), FStreamableManager::AsyncLoadHighPriority);
+	if (!preload_handle_.IsValid())OnPreloaded();//Nothing to load
+}
+
+void UAssetCatalog::Deinitialize()
+{
+	Super::Deinitialize();
+
+	if (preload_handle_.IsValid())
+	{
+		preload_handle_->CancelHandle();
+		preload_handle_.Reset();
+	}
+	assets_.Empty();
+	is_preloaded_ = false;
+}
+
+UObject* UAssetCatalog::GetAsset(EAssetKey key)
+{
+	int32 index = static_cast<int32>(key);
+	if (!assets_.IsValidIndex(index))return nullptr;
+	if (assets_[index] == nullptr && !paths_[index].IsNull())
+	{
+		//Needed before the preload is done, or it failed
+		assets_[index] = paths_[index].TryLoad();
+		if (assets_[index] == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("AssetCatalog.cpp: GetAsset: Failed to load %s"), *paths_[index].ToString());
+			paths_[index].Reset();//Do not try again
+		}
+	}
+	return assets_[index];
+}
+
+UTexture2D* UAssetCatalog::GetSkillIcon(int32 skill_type, int32 level)
+{
+	if (level < 1 || level > kMaxSkillLevel)return nullptr;
+	EAssetKey first_key;
+	switch (skill_type)
+	{
+	case 1:
+		first_key = EAssetKey::AxeIcon1;
+		break;
+	case 2:
+		first_key = EAssetKey::HoeIcon1;
+		break;
+	case 3:
+		first_key = EAssetKey::ScytheIcon1;
+		break;
+	default:
+		UE_LOG(LogTemp, Error, TEXT("AssetCatalog.cpp: GetSkillIcon: Invalid skill type %d"), skill_type);
+		return nullptr;
+	}
+	return Get<UTexture2D>(static_cast<EAssetKey>(static_cast<int32>(first_key) + level - 1));
+}
+
+float UAssetCatalog::get_preload_progress() const
+{
+	if (is_preloaded_)return 1.0f;
+	return preload_handle_.IsValid() ? preload_handle_->GetLoadingProgress() : 0.0f;
+}
+
+void UAssetCatalog::AddAsset(EAssetKey key, const TCHAR* path)
+{
+	paths_[static_cast<int32>(key)] = FSoftObjectPath(path);
+}
+
+void UAssetCatalog::OnPreloaded()
+{
+	int32 missing_count = 0;
+	for (int32 i = 0; i < paths_.Num(); i++)
+	{
+		if (assets_[i] == nullptr)assets_[i] = paths_[i].ResolveObject();
+		if (assets_[i] == nullptr)missing_count++;
+	}
+	is_preloaded_ = true;
+	//The assets are pinned by assets_ from now on
+	if (preload_handle_.IsValid())
+	{
+		preload_handle_->ReleaseHandle();
+		preload_handle_.Reset();
+	}
+	UE_LOG(LogTemp, Warning, TEXT("Asset catalog preloaded, %d of %d assets missing"), missing_count, paths_.Num());
+}
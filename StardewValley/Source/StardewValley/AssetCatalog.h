@@ -0,0 +1,98 @@
+/*****************************************************************
+ * \file   AssetCatalog.h
+ * \brief  The blueprint classes and textures used during play, by key. Every asset is loaded once,
+ * \brief  asynchronously at startup, and kept from garbage collection, so a lookup is an array read.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/StreamableManager.h"
+#include "AssetCatalog.generated.h"
+
+class UTexture2D;
+
+/**
+ * The keys of the assets. The type of each asset is in the comment.
+ */
+enum class EAssetKey : uint8
+{
+	//Ground blueprints, UClass. In the order of EGroundType
+	GrassGroundClass,
+	EarthGroundClass,
+	FieldGroundClass,
+	SnowGroundClass,
+	WaterGroundClass,
+	//Item block blueprints, UClass
+	TreeBlockClass,
+	TransparentWallBlockClass,
+	WheatCropBlockClass,
+	//Character blueprints, UClass
+	MyCharacterClass,
+	NPCCharacterClass,
+	//Widget blueprints, UClass
+	MenuWidgetClass,
+	ShortcutWidgetClass,
+	//Icons, UTexture2D
+	MissingIcon,//Shown for an item without an icon
+	EmptyShortcutIcon,
+	AxeIcon1, AxeIcon2, AxeIcon3, AxeIcon4,
+	HoeIcon1, HoeIcon2, HoeIcon3, HoeIcon4,
+	ScytheIcon1, ScytheIcon2, ScytheIcon3, ScytheIcon4,
+
+	Num
+};
+
+/**
+ *
+ */
+UCLASS()
+class STARDEWVALLEY_API UAssetCatalog : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+	/**
+	 * \brief Get the asset of the key. If the preload has not got it yet, it is loaded now.
+	 *
+	 * \param key The key of the asset
+	 * \return The asset, nullptr if it can not be loaded
+	 */
+	UObject* GetAsset(EAssetKey key);
+	template<typename T>
+	T* Get(EAssetKey key) { return Cast<T>(GetAsset(key)); };
+	UClass* GetClass(EAssetKey key) { return Get<UClass>(key); };
+	/**
+	 * \brief Get the icon of a skill at a level.
+	 *
+	 * \param skill_type 1 axe, 2 hoe, 3 scythe
+	 * \param level The level, from 1 to 4
+	 * \return The icon, nullptr if there is not
+	 */
+	UTexture2D* GetSkillIcon(int32 skill_type, int32 level);
+	bool is_preloaded() const { return is_preloaded_; };
+	/**
+	 * \brief Get how much of the preload is done.
+	 *
+	 * \return A float, from 0 to 1
+	 */
+	float get_preload_progress() const;
+private:
+	void AddAsset(EAssetKey key, const TCHAR* path);
+	/**
+	 * \brief Pin the preloaded assets. Called when the async load is done.
+	 */
+	void OnPreloaded();
+
+	UPROPERTY()
+	TArray<UObject*> assets_;//Indexed by key, pinned against garbage collection
+	TArray<FSoftObjectPath> paths_;//Indexed by key
+	FStreamableManager streamable_manager_;
+	TSharedPtr<FStreamableHandle> preload_handle_;
+	bool is_preloaded_;
+	const int32 kMaxSkillLevel = 4;
+};
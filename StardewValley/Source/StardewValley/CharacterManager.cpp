@@ -10,18 +10,21 @@
 #include "CharacterManager.h"
 #include "MyCharacter.h"
 #include "NPC_Character.h"
+#include "AssetCatalog.h"
+#include "DataSystem.h"
 
 void UCharacterManager::CharacterGenerate() {
 	UE_LOG(LogTemp, Warning, TEXT("Character Generate"));
 
-	UClass* AMyCharacterClass = LoadObject<UClass>(nullptr, TEXT("/Game/Character/BP_MyCharacter.BP_MyCharacter_C"));
-	FVector SpawnLocation = FVector(1000.0f, 5500.0f, 1000.0f);
+	UAssetCatalog* AssetCatalog = GetGameInstance()->GetSubsystem<UAssetCatalog>();
+	UClass* AMyCharacterClass = AssetCatalog->GetClass(EAssetKey::MyCharacterClass);
+	FVector SpawnLocation = GetSpawnLocation();
 	FRotator SpawnRotation = FRotator(0.0f, 0.0f, 0.0f);
 	UWorld* World = GetWorld();
 	if (World == nullptr) return;
 	AMyCharacter* CharacterInstance = World->SpawnActor<AMyCharacter>(AMyCharacterClass, SpawnLocation, SpawnRotation);
 
-	UClass* ANPC_CharacterClass = LoadObject<UClass>(nullptr, TEXT("/Game/Character/BP_NPC_Character.BP_NPC_Character_C"));
+	UClass* ANPC_CharacterClass = AssetCatalog->GetClass(EAssetKey::NPCCharacterClass);
 	FVector SpawnLocation1 = FVector(1400.0f, 5500.0f, 75.0f);
 	FRotator SpawnRotation1 = FRotator(0.0f, 0.0f, 0.0f);
 	ANPC_Character* NPC_CharacterInstance1 = World->SpawnActor<ANPC_Character>(ANPC_CharacterClass, SpawnLocation1, SpawnRotation1);
@@ -30,13 +33,26 @@ void UCharacterManager::CharacterGenerate() {
 	GetWorld()->GetFirstPlayerController()->Possess(CharacterInstance);
 }
 
+FVector UCharacterManager::GetSpawnLocation()
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	int32 chunk_x = DataSystem->get_player_chunk_x();
+	int32 chunk_y = DataSystem->get_player_chunk_y();
+	if (chunk_x < 0 || chunk_y < 0 || chunk_x >= DataSystem->get_chunk_x_count() || chunk_y >= DataSystem->get_chunk_y_count())
+	{
+		return kDefaultSpawnLocation;
+	}
+	float chunk_length = DataSystem->get_chunk_size() * DataSystem->get_ground_block_size();
+	return FVector((chunk_x + 0.5f) * chunk_length, (chunk_y + 0.5f) * chunk_length, kDefaultSpawnLocation.Z);
+}
+
 void UCharacterManager::Initialize(FSubsystemCollectionBase& Collection) {
 	Super::Initialize(Collection);
 	UE_LOG(LogTemp, Warning, TEXT("CharacterManager Initialize"));
 	
 	UEventSystem* EventSystem = Collection.InitializeDependency<UEventSystem>();
 
-	EventSystem->OnGroundGenerated.AddUObject(this, &UCharacterManager::CharacterGenerate);
+	EventSystem->Subscribe(EventSystem->OnGroundGenerated, TEXT("OnGroundGenerated"), this, &UCharacterManager::CharacterGenerate);
 }
 
 void UCharacterManager::CharacterSave(){
@@ -25,10 +25,16 @@ public:
 	void Initialize(FSubsystemCollectionBase& Collection) override;
 
 	void CharacterGenerate();
+	/**
+	 * \brief Get where the character spawns, the middle of the chunk it was saved in, or the default location for a new game.
+	 */
+	FVector GetSpawnLocation();
 
 	void CharacterSave();
 
 	void CharacterLoad();
+private:
+	const FVector kDefaultSpawnLocation = FVector(1000.0f, 5500.0f, 1000.0f);
 /*
 protected:
 	
@@ -0,0 +1,292 @@
+/*****************************************************************//**
+ * \file   CropSystem.cpp
+ * \brief  The implementation of the crop system
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "CropSystem.h"
+#include "DataSystem.h"
+#include "EventSystem.h"
+#include "ItemRegistry.h"
+#include "ItemBlockBase.h"
+
+void UCropSystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	present_minute_ = 0;
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->Subscribe(EventSystem->OnWeatherChanged, TEXT("OnWeatherChanged"), this, &UCropSystem::RainWatersCrops);
+	EventSystem->Subscribe(EventSystem->OnDayChanged, TEXT("OnDayChanged"), this, &UCropSystem::GetCropsThirsty);
+	EventSystem->Subscribe(EventSystem->OnGameSaving, TEXT("OnGameSaving"), this, &UCropSystem::FlushToDataSystem);
+}
+
+void UCropSystem::Deinitialize()
+{
+	Super::Deinitialize();
+
+	//The data system may save after this
+	FlushToDataSystem();
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (EventSystem)
+	{
+		EventSystem->UnsubscribeAll(this);
+	}
+}
+
+void UCropSystem::ResetCrops()
+{
+	crop_tile_.Empty();
+	crop_id_.Empty();
+	crop_grown_time_.Empty();
+	crop_watered_minute_.Empty();
+	crop_deadline_.Empty();
+	is_crop_watered_.Empty();
+	deadlines_.Empty();
+	watering_changes_.Empty();
+	tile_crop_.Init(INDEX_NONE, GetGameInstance()->GetSubsystem<UDataSystem>()->get_tiles().Num());
+}
+
+void UCropSystem::AddCrop(int32 x_index, int32 y_index, int32 since_minute)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	if (!tiles.IsValidIndex(x_index, y_index))return;
+	int32 tile = tiles.Index(x_index, y_index);
+	if (tile_crop_.Num() != tiles.Num())ResetCrops();//The map has been resized
+	if (tile_crop_[tile] != INDEX_NONE)return;//Already growing
+
+	int32 lived_time = FTileStore::At(tiles.lived_time_, tile);
+	bool is_watered = FTileStore::At(tiles.is_watered_, tile);
+	if (lived_time == -1)lived_time = 0;
+
+	//Catch up with the minutes since the data, as if the crop had been growing all along
+	int32 minute = since_minute == INDEX_NONE ? present_minute_ : FMath::Min(since_minute, present_minute_);
+	for (const FWateringChange& change : watering_changes_)
+	{
+		if (change.minute_ < minute)continue;
+		if (is_watered)lived_time += change.minute_ - minute;
+		minute = change.minute_;
+		is_watered = change.is_watered_;
+	}
+	if (lived_time != FTileStore::At(tiles.lived_time_, tile) || is_watered != FTileStore::At(tiles.is_watered_, tile))
+	{
+		FTileStore::At(tiles.lived_time_, tile) = lived_time;
+		FTileStore::At(tiles.is_watered_, tile) = is_watered;
+		DataSystem->MarkTileDirty(tile);
+	}
+
+	int32 crop = crop_tile_.Add(tile);
+	tile_crop_[tile] = crop;
+	crop_id_.Add(FTileStore::At(tiles.item_id_, tile));
+	crop_grown_time_.Add(lived_time);
+	crop_watered_minute_.Add(minute);
+	crop_deadline_.Add(INDEX_NONE);
+	is_crop_watered_.Add(is_watered);
+	if (is_watered)
+	{
+		//Watered since the minute, a deadline passed meanwhile comes on the next minute
+		const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(crop_id_[crop]);
+		if (item_info != nullptr)ScheduleCrop(crop, *item_info);
+	}
+}
+
+void UCropSystem::RemoveCrop(int32 x_index, int32 y_index)
+{
+	FTileStore& tiles = GetGameInstance()->GetSubsystem<UDataSystem>()->get_tiles();
+	if (!tiles.IsValidIndex(x_index, y_index))return;
+	int32 tile = tiles.Index(x_index, y_index);
+	if (!tile_crop_.IsValidIndex(tile) || tile_crop_[tile] == INDEX_NONE)return;
+	RemoveCropAt(tile_crop_[tile]);
+}
+
+bool UCropSystem::WaterCrop(int32 x_index, int32 y_index)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	if (!tiles.IsValidIndex(x_index, y_index))return false;
+	int32 tile = tiles.Index(x_index, y_index);
+	if (!tile_crop_.IsValidIndex(tile) || tile_crop_[tile] == INDEX_NONE)return false;
+	ResumeCrop(tile_crop_[tile]);
+	FTileStore::At(tiles.is_watered_, tile) = true;
+	DataSystem->MarkTileDirty(tile);
+	return true;
+}
+
+int32 UCropSystem::GetCropLivedTime(int32 x_index, int32 y_index)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	if (!tiles.IsValidIndex(x_index, y_index))return -1;
+	int32 tile = tiles.Index(x_index, y_index);
+	if (!tile_crop_.IsValidIndex(tile) || tile_crop_[tile] == INDEX_NONE)return FTileStore::At(tiles.lived_time_, tile);
+	return GetLivedTime(tile_crop_[tile]);
+}
+
+void UCropSystem::FlushToDataSystem()
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	if (DataSystem == nullptr)return;
+	FTileStore& tiles = DataSystem->get_tiles();
+	for (int32 crop = 0; crop < crop_tile_.Num(); crop++)
+	{
+		if (!tiles.IsValidIndex(crop_tile_[crop]))continue;
+		int32& lived_time = FTileStore::At(tiles.lived_time_, crop_tile_[crop]);
+		if (lived_time == GetLivedTime(crop))continue;
+		lived_time = GetLivedTime(crop);
+		DataSystem->MarkTileDirty(crop_tile_[crop]);
+	}
+}
+
+void UCropSystem::AdvanceCrops(int32 minutes)
+{
+	if (minutes <= 0)return;
+	present_minute_ += minutes;
+	if (deadlines_.Num() == 0 || deadlines_.HeapTop().minute_ > present_minute_)return;
+
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	UItemRegistry* ItemRegistry = GetGameInstance()->GetSubsystem<UItemRegistry>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	while (deadlines_.Num() > 0 && deadlines_.HeapTop().minute_ <= present_minute_)
+	{
+		FCropDeadline deadline;
+		deadlines_.HeapPop(deadline, false);
+		int32 crop = tile_crop_.IsValidIndex(deadline.tile_) ? tile_crop_[deadline.tile_] : INDEX_NONE;
+		if (crop == INDEX_NONE || crop_deadline_[crop] != deadline.minute_)continue;//Outdated
+
+		int32 lived_time = GetLivedTime(crop);
+		FTileStore::At(tiles.lived_time_, deadline.tile_) = lived_time;
+		DataSystem->MarkTileDirty(deadline.tile_);
+		const FItemDefinition* item_info = ItemRegistry->GetItemDefinition(crop_id_[crop]);
+		if (item_info == nullptr)
+		{
+			crop_deadline_[crop] = INDEX_NONE;
+			continue;
+		}
+		if (lived_time >= item_info->total_lifespan_)
+		{
+			KillCrop(crop);
+			continue;
+		}
+		int32 status = item_info->GetStatusReachedAt(lived_time);
+		if (status != 0)
+		{
+			AItemBlockBase* item_block = FTileStore::At(tiles.item_block_, deadline.tile_);
+			if (item_block != nullptr)item_block->SetAppearanceByStatus(status);//The chunk may be released
+		}
+		ScheduleCrop(crop, *item_info);
+	}
+}
+
+void UCropSystem::RainWatersCrops()
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	if (DataSystem->get_present_weather() != kWateringWeather)return;
+	AddWateringChange(true);
+	FTileStore& tiles = DataSystem->get_tiles();
+	for (int32 crop = 0; crop < crop_tile_.Num(); crop++)
+	{
+		ResumeCrop(crop);
+		FTileStore::At(tiles.is_watered_, crop_tile_[crop]) = true;
+		DataSystem->MarkTileDirty(crop_tile_[crop]);
+	}
+}
+
+void UCropSystem::GetCropsThirsty()
+{
+	AddWateringChange(false);
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	for (int32 crop = 0; crop < crop_tile_.Num(); crop++)
+	{
+		PauseCrop(crop);
+		FTileStore::At(tiles.is_watered_, crop_tile_[crop]) = false;
+		FTileStore::At(tiles.lived_time_, crop_tile_[crop]) = crop_grown_time_[crop];
+		DataSystem->MarkTileDirty(crop_tile_[crop]);
+	}
+	//Every deadline is outdated now
+	deadlines_.Reset();
+}
+
+void UCropSystem::AddWateringChange(bool is_watered)
+{
+	if (watering_changes_.Num() >= kMaxWateringChanges)watering_changes_.RemoveAt(0);
+	watering_changes_.Add(FWateringChange{ present_minute_, is_watered });
+}
+
+void UCropSystem::ResumeCrop(int32 crop)
+{
+	if (is_crop_watered_[crop])return;
+	is_crop_watered_[crop] = true;
+	crop_watered_minute_[crop] = present_minute_;
+	const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(crop_id_[crop]);
+	if (item_info != nullptr)ScheduleCrop(crop, *item_info);
+}
+
+void UCropSystem::PauseCrop(int32 crop)
+{
+	if (!is_crop_watered_[crop])return;
+	crop_grown_time_[crop] = GetLivedTime(crop);
+	is_crop_watered_[crop] = false;
+	crop_deadline_[crop] = INDEX_NONE;
+}
+
+int32 UCropSystem::GetLivedTime(int32 crop) const
+{
+	if (!is_crop_watered_[crop])return crop_grown_time_[crop];
+	return crop_grown_time_[crop] + present_minute_ - crop_watered_minute_[crop];
+}
+
+void UCropSystem::ScheduleCrop(int32 crop, const FItemDefinition& item_info)
+{
+	int32 lived_time = GetLivedTime(crop);
+	int32 next_time = item_info.GetNextChangeTime(lived_time);
+	int32 minute = present_minute_ + FMath::Max(next_time - lived_time, 1);
+	crop_deadline_[crop] = minute;
+	deadlines_.HeapPush(FCropDeadline{ minute, crop_tile_[crop] });
+	if (deadlines_.Num() > 4 * crop_tile_.Num() + 64)CompactDeadlines();
+}
+
+void UCropSystem::CompactDeadlines()
+{
+	deadlines_.Reset();
+	for (int32 crop = 0; crop < crop_tile_.Num(); crop++)
+	{
+		if (crop_deadline_[crop] != INDEX_NONE)deadlines_.Add(FCropDeadline{ crop_deadline_[crop], crop_tile_[crop] });
+	}
+	deadlines_.Heapify();
+}
+
+void UCropSystem::RemoveCropAt(int32 crop)
+{
+	//Its deadline stays in the queue and is dropped as outdated
+	tile_crop_[crop_tile_[crop]] = INDEX_NONE;
+	int32 last_crop = crop_tile_.Num() - 1;
+	if (crop != last_crop)
+	{
+		tile_crop_[crop_tile_[last_crop]] = crop;
+	}
+	crop_tile_.RemoveAtSwap(crop, 1, false);
+	crop_id_.RemoveAtSwap(crop, 1, false);
+	crop_grown_time_.RemoveAtSwap(crop, 1, false);
+	crop_watered_minute_.RemoveAtSwap(crop, 1, false);
+	crop_deadline_.RemoveAtSwap(crop, 1, false);
+	is_crop_watered_.RemoveAtSwap(crop, 1, false);
+}
+
+void UCropSystem::KillCrop(int32 crop)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	int32 tile = crop_tile_[crop];
+	AItemBlockBase* item_block = FTileStore::At(tiles.item_block_, tile);
+	FTileStore::At(tiles.item_id_, tile) = -1;
+	FTileStore::At(tiles.lived_time_, tile) = -1;
+	FTileStore::At(tiles.is_watered_, tile) = false;
+	FTileStore::At(tiles.item_block_, tile) = nullptr;
+	DataSystem->MarkTileDirty(tile);
+	RemoveCropAt(crop);
+	if (item_block != nullptr)item_block->Destroy();
+}
@@ -0,0 +1,149 @@
+/*****************************************************************
+ * \file   CropSystem.h
+ * \brief  The system that grows all the crops. The state of the crops is kept in arrays.
+ * \brief  Each watered crop waits in a queue for the minute it reaches its next status,
+ * \brief  only those crops are woken up. The actors are only touched when a crop
+ * \brief  reaches a new status or dies.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "CropSystem.generated.h"
+
+struct FItemDefinition;
+
+/**
+ *
+ */
+UCLASS()
+class STARDEWVALLEY_API UCropSystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+private:
+	/**
+	 * A crop waiting for its next status. It is outdated if the crop has been paused, removed or rescheduled.
+	 */
+	struct FCropDeadline
+	{
+		int32 minute_;
+		int32 tile_;
+		bool operator<(const FCropDeadline& other) const { return minute_ < other.minute_; };
+	};
+	/**
+	 * A change of the watering of every crop, kept so a crop added late catches up with it.
+	 */
+	struct FWateringChange
+	{
+		int32 minute_;
+		bool is_watered_;//true for rain, false for a new day
+	};
+	//One element per crop. A crop is removed by moving the last crop into its place.
+	TArray<int32> crop_tile_;//The index of the block of the crop
+	TArray<int32> crop_id_;
+	TArray<int32> crop_grown_time_;//The lived time when the crop was last watered or got thirsty
+	TArray<int32> crop_watered_minute_;//The minute the crop was last watered
+	TArray<int32> crop_deadline_;//The minute of the next status, INDEX_NONE if the crop is not growing
+	TArray<bool> is_crop_watered_;
+	TArray<int32> tile_crop_;//Block -> crop, INDEX_NONE if there is no crop on the block
+	TArray<FCropDeadline> deadlines_;//A min-heap on the minute
+	int32 present_minute_;//Counts the game minutes since the game started
+	TArray<FWateringChange> watering_changes_;//The last ones, oldest first
+	const int32 kWateringWeather = 3;//The weather that waters the crops
+	const int32 kMaxWateringChanges = 64;
+public:
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+	/**
+	 * \brief Forget all the crops and size the lookup for the present map.
+	 */
+	void ResetCrops();
+	/**
+	 * \brief Start growing the crop at the given index. The id, lived time and watering state are read from the data system.
+	 *
+	 * \param x_index The first index of the block
+	 * \param y_index The second index of the block
+	 * \param since_minute The minute the data of the crop is of. The crop grows the minutes since and follows the rain and the days meanwhile.
+	 * \param since_minute INDEX_NONE for the present minute
+	 */
+	void AddCrop(int32 x_index, int32 y_index, int32 since_minute = INDEX_NONE);
+	/**
+	 * \brief Stop growing the crop at the given index. Does nothing if there is no crop.
+	 *
+	 * \param x_index The first index of the block
+	 * \param y_index The second index of the block
+	 */
+	void RemoveCrop(int32 x_index, int32 y_index);
+	/**
+	 * \brief Water the crop at the given index.
+	 *
+	 * \param x_index The first index of the block
+	 * \param y_index The second index of the block
+	 * \return A bool, false if there is no crop
+	 */
+	bool WaterCrop(int32 x_index, int32 y_index);
+	/**
+	 * \brief Get the lived time of the crop at the given index.
+	 *
+	 * \param x_index The first index of the block
+	 * \param y_index The second index of the block
+	 * \return An int32, the lived time in the data system if there is no crop
+	 */
+	int32 GetCropLivedTime(int32 x_index, int32 y_index);
+	/**
+	 * \brief Write the lived time of every crop to the data system. Called before the game is saved.
+	 */
+	void FlushToDataSystem();
+	/**
+	 * \brief Grow the crops by the given minutes at once. Only the crops that reach a new status or die are touched.
+	 * \brief Called by the time system as the clock runs. The watering state must not change in between,
+	 * \brief the time system splits the minutes at day and weather changes.
+	 *
+	 * \param minutes The number of minutes to grow
+	 */
+	void AdvanceCrops(int32 minutes);
+	int32 get_crop_count() const { return crop_tile_.Num(); };
+	int32 get_present_minute() const { return present_minute_; };
+	int32 get_pending_deadline_count() const { return deadlines_.Num(); };
+private:
+	/**
+	 * \brief Water every crop if it rains. Called when the weather changes.
+	 */
+	void RainWatersCrops();
+	/**
+	 * \brief Every crop needs water again. Called when the day changes.
+	 */
+	void GetCropsThirsty();
+	/**
+	 * \brief Remember a change of the watering of every crop, for the crops added later.
+	 */
+	void AddWateringChange(bool is_watered);
+	/**
+	 * \brief The crop starts growing from now on.
+	 */
+	void ResumeCrop(int32 crop);
+	/**
+	 * \brief The crop stops growing, its deadline is dropped.
+	 */
+	void PauseCrop(int32 crop);
+	int32 GetLivedTime(int32 crop) const;
+	/**
+	 * \brief Queue the crop for the minute it reaches its next status or dies.
+	 */
+	void ScheduleCrop(int32 crop, const FItemDefinition& item_info);
+	/**
+	 * \brief Rebuild the queue from the crops when it is full of outdated deadlines.
+	 */
+	void CompactDeadlines();
+	/**
+	 * \brief Remove the crop from the arrays. The last crop takes its place.
+	 */
+	void RemoveCropAt(int32 crop);
+	/**
+	 * \brief The crop has lived its whole lifespan, remove it from the map.
+	 */
+	void KillCrop(int32 crop);
+};
@@ -8,135 +8,607 @@
 
 #include "DataSystem.h"
 #include "MySaveGame.h"
+#include "SaveFormat.h"
+#include "SaveSlotManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Containers/Ticker.h"
 #include "TimeSystem.h"
+#include "WeatherSystem.h"
+#include "EventSystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Take save snapshot"), STAT_TakeSnapshot, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Write save slot"), STAT_WriteSaveSlot, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Save completed"), STAT_SaveCompleted, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Decode save chunks"), STAT_DecodeSave, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Save decoded"), STAT_SaveDecoded, STATGROUP_Game);
+
+static TAutoConsoleVariable<float> CVarAutosaveInterval(
+	TEXT("sv.AutosaveInterval"),
+	0.0f,
+	TEXT("Seconds between autosaves, besides the one at the start of each day. 0 autosaves only at the start of each day."));
+static TAutoConsoleVariable<int32> CVarAutosaveCompaction(
+	TEXT("sv.AutosaveCompaction"),
+	16,
+	TEXT("Autosaves appended to the journal before the next one is a full save again."));
+
+/**
+ * A loaded save whose chunks are being decoded, by the game thread on demand and by a worker for the rest.
+ */
+struct FSaveDecode
+{
+	//The bytes of the save, a mapped file where the platform can, so the chunks not decoded yet are never read in
+	TUniquePtr<IMappedFileHandle> mapped_file_;
+	TUniquePtr<IMappedFileRegion> mapped_region_;
+	TArray<uint8> data_;//If the file can not be mapped
+	const uint8* bytes_ = nullptr;
+	int64 size_ = 0;
+
+	FSaveSnapshot snapshot_;//The map and the chunk index, its layers are empty
+	TArray<TArray<FSaveTile>> pending_tiles_;//The blocks of the journal by chunk, applied after the chunk
+	TArray<int32> chunk_state_;//kNotDecoded, kDecoding or kDecoded, changed atomically
+	FTileStore* tiles_ = nullptr;//Decoded into. Each chunk writes only its own blocks, so chunks are decoded at once safely
+	FThreadSafeCounter damaged_count_;
+
+	static constexpr int32 kNotDecoded = 0;
+	static constexpr int32 kDecoding = 1;
+	static constexpr int32 kDecoded = 2;
+
+	bool Open(const FString& slot_name)
+	{
+		mapped_file_.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*USaveSlotManager::GetSavePath(slot_name)));
+		if (mapped_file_.IsValid())mapped_region_.Reset(mapped_file_->MapRegion());
+		if (mapped_region_.IsValid())
+		{
+			bytes_ = mapped_region_->GetMappedPtr();
+			size_ = mapped_region_->GetMappedSize();
+			return true;
+		}
+		mapped_file_.Reset();
+		//Not a file on this platform, or it can not be mapped
+		if (!UGameplayStatics::LoadDataFromSlot(data_, slot_name, 0))return false;
+		bytes_ = data_.GetData();
+		size_ = data_.Num();
+		return true;
+	}
+	/**
+	 * \brief Let go of the bytes, so the slot can be written again. Every chunk must be decoded.
+	 */
+	void Close()
+	{
+		mapped_region_.Reset();
+		mapped_file_.Reset();
+		data_.Empty();
+		bytes_ = nullptr;
+		size_ = 0;
+	}
+	/**
+	 * \brief Decode a chunk into the tile store, unless another thread has. Waits if another thread is decoding it.
+	 */
+	void DecodeChunk(int32 chunk)
+	{
+		int32 state = FPlatformAtomics::InterlockedCompareExchange(&chunk_state_[chunk], kDecoding, kNotDecoded);
+		if (state == kDecoded)return;
+		if (state == kDecoding)
+		{
+			while (FPlatformAtomics::AtomicRead(&chunk_state_[chunk]) != kDecoded)FPlatformProcess::Yield();
+			return;
+		}
+
+		FSaveSnapshot blocks;
+		int32 x_begin = 0;
+		int32 y_begin = 0;
+		if (!FSaveFormat::ReadChunk(bytes_, size_, snapshot_, chunk, blocks, x_begin, y_begin))damaged_count_.Increment();
+		//A damaged chunk is left as read, the rest of its blocks empty
+		if (blocks.IsTilesSized())
+		{
+			for (int32 x = 0; x < blocks.x_length_; x++)
+				for (int32 y = 0, from = x * blocks.y_length_; y < blocks.y_length_; y++, from++)
+				{
+					int32 to = tiles_->Index(x_begin + x, y_begin + y);
+					FTileStore::At(tiles_->ground_type_, to) = blocks.ground_type_[from];
+					FTileStore::At(tiles_->delta_temperature_, to) = blocks.delta_temperature_[from];
+					FTileStore::At(tiles_->item_id_, to) = blocks.item_id_[from];
+					FTileStore::At(tiles_->lived_time_, to) = blocks.lived_time_[from];
+					FTileStore::At(tiles_->durability_, to) = blocks.durability_[from];
+					FTileStore::At(tiles_->is_watered_, to) = blocks.is_watered_[from];
+				}
+		}
+		for (const FSaveTile& tile : pending_tiles_[chunk])
+		{
+			FTileStore::At(tiles_->ground_type_, tile.index_) = tile.ground_type_;
+			FTileStore::At(tiles_->delta_temperature_, tile.index_) = tile.delta_temperature_;
+			FTileStore::At(tiles_->item_id_, tile.index_) = tile.item_id_;
+			FTileStore::At(tiles_->lived_time_, tile.index_) = tile.lived_time_;
+			FTileStore::At(tiles_->durability_, tile.index_) = tile.durability_;
+			FTileStore::At(tiles_->is_watered_, tile.index_) = tile.is_watered_;
+		}
+		FPlatformAtomics::InterlockedExchange(&chunk_state_[chunk], kDecoded);
+	}
+};
 
 void UDataSystem::Initialize(FSubsystemCollectionBase& Collection)
 {
     Super::Initialize(Collection);
 
 	do_save = true;
+	chunk_size_ = 16;
+	ground_block_size_ = 0;
+	is_items_initialized_ = false;
+	is_temperature_initialized_ = false;
+	map_seed_ = 0;
+	is_player_dirty_ = false;
+	is_full_save_needed_ = true;//Nothing to follow yet
+	save_id_ = 0;
+	journal_record_count_ = 0;
+	last_save_time_ = FPlatformTime::Seconds();
+	decode_start_time_ = 0.0;
+	player_chunk_x_ = -1;
+	player_chunk_y_ = -1;
+	slot_name_ = Collection.InitializeDependency<USaveSlotManager>()->GetLatestSlotName();//Continue the game saved last
 	LoadGame();
+
+	UEventSystem* EventSystem = Collection.InitializeDependency<UEventSystem>();
+	EventSystem->Subscribe(EventSystem->OnDayChanged, TEXT("OnDayChanged"), this, &UDataSystem::Autosave);
+	EventSystem->Subscribe(EventSystem->OnPlayerChunkChanged, TEXT("OnPlayerChunkChanged"), this, &UDataSystem::set_player_chunk);
+	autosave_ticker_ = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UDataSystem::TickAutosave), kAutosaveCheckPeriod);
 }
 
 void UDataSystem::Deinitialize()
 {
     Super::Deinitialize();
 	
+	FTicker::GetCoreTicker().RemoveTicker(autosave_ticker_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (EventSystem)
+	{
+		EventSystem->UnsubscribeAll(this);
+	}
+	WaitForDecode();
 	if (do_save)SaveGame();
+	WaitForSave();//Nothing is written after the game instance is gone
 }
 
-void UDataSystem::SaveGame()
-{
-	UMySaveGame* SaveGameInstance = Cast<UMySaveGame>(UGameplayStatics::CreateSaveGameObject(UMySaveGame::StaticClass()));
-	if (SaveGameInstance)
-	{
-		// Populate the save game instance with data
-		SaveGameInstance->minute_ = minute_;
-		SaveGameInstance->hour_ = hour_;
-		SaveGameInstance->day_in_season_ = day_in_season_;
-		SaveGameInstance->season_ = present_season_;
-		SaveGameInstance->real_time_ = real_time_;//Time system data saved
-		SaveGameInstance->weather_ = present_weather_;
-		SaveGameInstance->base_temperature_ = present_base_temperature_;//Weather system data saved
-		SaveGameInstance->ground_block_x_length_ = ground_block_x_length_;
-		SaveGameInstance->ground_block_y_length_ = ground_block_y_length_;
-		SaveGameInstance->ground_block_size_ = ground_block_size_;
-		SaveGameInstance->ground_block_type_.Empty();
-		SaveGameInstance->ground_block_delta_temperature_.Empty();
-		for (int i = 0; i < ground_block_x_length_ * ground_block_y_length_; i++)//Ground block data saved
-		{
-			SaveGameInstance->ground_block_type_.Add(ground_block_type_[i]);
-			//SaveGameInstance->ground_block_delta_temperature_.Add(ground_block_delta_temperature_[i]);
-		}
-		SaveGameInstance->is_items_initialized_ = is_items_initialized_;
-		for (int i = 0; i < item_block_lived_time_.Num(); i++)
+void UDataSystem::set_ground_block_lengths(int32 x_length, int32 y_length)
+{
+	if (x_length == tiles_.get_x_length() && y_length == tiles_.get_y_length())return;
+
+	//All the arrays are sized here once, the setters never grow them
+	tiles_.Reset(x_length, y_length);
+	is_chunk_loaded_.Init(false, get_chunk_x_count() * get_chunk_y_count());
+	is_tile_dirty_.Init(false, tiles_.Num());
+	dirty_tiles_.Reset();
+	is_full_save_needed_ = true;
+}
+
+void UDataSystem::SaveGame(TFunction<void(bool)> on_saved)
+{
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (EventSystem)
+		EventSystem->BroadcastEvent(EventSystem->OnGameSaving);
+
+	WriteFullSave(MoveTemp(on_saved));
+}
+void UDataSystem::Autosave()
+{
+	if (!is_items_initialized_)return;//No map yet
+
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (EventSystem)
+		EventSystem->BroadcastEvent(EventSystem->OnGameSaving);
+
+	//Compacted into a full save now and then, so loading never replays a long journal
+	if (is_full_save_needed_ || journal_record_count_ >= CVarAutosaveCompaction.GetValueOnGameThread() || dirty_tiles_.Num() > tiles_.Num() / kMaxDirtyFraction)
+	{
+		WriteFullSave(nullptr);
+	}
+	else
+	{
+		WriteJournalRecord();
+	}
+}
+void UDataSystem::WaitForSave()
+{
+	if (save_task_.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(save_task_, ENamedThreads::GameThread);
+		save_task_ = nullptr;
+	}
+}
+void UDataSystem::WriteFullSave(TFunction<void(bool)> on_saved)
+{
+	//The game thread only copies the layers, the worker owns the copy from here
+	double start_time = FPlatformTime::Seconds();
+	TSharedRef<FSaveSnapshot, ESPMode::ThreadSafe> snapshot = MakeShared<FSaveSnapshot, ESPMode::ThreadSafe>();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TakeSnapshot);
+		TakeSnapshot(snapshot.Get());
+	}
+	//A new id, the records of the old journal no longer apply
+	save_id_ = FMath::Max<uint32>(FCrc::MemCrc32(&start_time, sizeof(start_time), save_id_ + 1), 1);
+	snapshot->save_id_ = save_id_;
+	ClearJournal();
+	journal_record_count_ = 0;
+
+	ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem();//Got here, the module manager is not for workers
+	FString slot_name = slot_name_;
+	FString journal_path = GetJournalPath();
+	TWeakObjectPtr<UDataSystem> WeakThis(this);
+	DispatchWrite([snapshot, SaveSystem, slot_name, journal_path](int32& size)
 		{
-			SaveGameInstance->item_block_lived_time_.Add(item_block_lived_time_[i]);
-		}
-		for (int i = 0; i < item_block_durability_.Num(); i++)
+			TArray<uint8> data;
+			if (SaveSystem == nullptr || !FSaveFormat::Write(snapshot.Get(), data) || !SaveSystem->SaveGame(false, *slot_name, 0, data))return false;
+			size = data.Num();
+			IFileManager::Get().Delete(*journal_path, false, false, true);
+			return true;
+		}, [WeakThis, on_saved = MoveTemp(on_saved)](bool is_saved)
 		{
-			SaveGameInstance->item_block_durability_.Add(item_block_durability_[i]);
-		}
-		for (int i = 0; i < is_item_block_watered_.Num(); i++)
+			//The journal was cleared for this save, the next autosave must not follow it
+			if (!is_saved && WeakThis.IsValid())WeakThis->is_full_save_needed_ = true;
+			if (on_saved)on_saved(is_saved);
+		}, start_time, TEXT("Save"));
+}
+void UDataSystem::WriteJournalRecord()
+{
+	double start_time = FPlatformTime::Seconds();
+	TSharedRef<FSaveDelta, ESPMode::ThreadSafe> delta = MakeShared<FSaveDelta, ESPMode::ThreadSafe>();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TakeSnapshot);
+		delta->save_id_ = save_id_;
+		FSaveSnapshot& state = delta->state_;
+		state.minute_ = minute_;
+		state.hour_ = hour_;
+		state.day_in_season_ = day_in_season_;
+		state.season_ = present_season_;
+		state.real_time_ = real_time_;
+		state.weather_ = present_weather_;
+		state.base_temperature_ = present_base_temperature_;
+		state.player_chunk_x_ = player_chunk_x_;
+		state.player_chunk_y_ = player_chunk_y_;
+		delta->is_player_changed_ = is_player_dirty_;
+		if (is_player_dirty_)
 		{
-			SaveGameInstance->is_item_block_watered_.Add(is_item_block_watered_[i]);
+			state.player_axe_level_ = player_axe_level_;
+			state.player_hoe_level_ = player_hoe_level_;
+			state.player_scythe_level_ = player_scythe_level_;
+			state.player_axe_exp_ = player_axe_exp_;
+			state.player_hoe_exp_ = player_hoe_exp_;
+			state.player_scythe_exp_ = player_scythe_exp_;
+			state.player_bag_ = player_bag_;
 		}
-		for (int i = 0; i < item_block_id_.Num(); i++)//Item block data saved
+		dirty_tiles_.Sort();
+		delta->tiles_.SetNum(dirty_tiles_.Num());
+		for (int32 i = 0; i < dirty_tiles_.Num(); i++)
 		{
-			SaveGameInstance->item_block_id_.Add(item_block_id_[i]);
-		}
-		SaveGameInstance->player_axe_level_ = player_axe_level_;
-		SaveGameInstance->player_hoe_level_ = player_hoe_level_;
-		SaveGameInstance->player_scythe_level_ = player_scythe_level_;
-		SaveGameInstance->player_axe_exp_ = player_axe_exp_;
-		SaveGameInstance->player_hoe_exp_ = player_hoe_exp_;
-		SaveGameInstance->player_scythe_exp_ = player_scythe_exp_;
-		for (auto it : player_bag_)//Player system data saved
-		{
-			SaveGameInstance->player_bag_.Add(it);
+			int32 index = dirty_tiles_[i];
+			FSaveTile& tile = delta->tiles_[i];
+			tile.index_ = index;
+			tile.ground_type_ = FTileStore::At(tiles_.ground_type_, index);
+			tile.delta_temperature_ = FTileStore::At(tiles_.delta_temperature_, index);
+			tile.item_id_ = FTileStore::At(tiles_.item_id_, index);
+			tile.lived_time_ = FTileStore::At(tiles_.lived_time_, index);
+			tile.durability_ = FTileStore::At(tiles_.durability_, index);
+			tile.is_watered_ = FTileStore::At(tiles_.is_watered_, index);
 		}
+	}
+	ClearJournal();
+	journal_record_count_++;
 
-		// Save the data to a file
-		bool bSuccess = UGameplayStatics::SaveGameToSlot(SaveGameInstance, TEXT("SavedGame"), 0);
-		if (bSuccess)
+	FString journal_path = GetJournalPath();
+	TWeakObjectPtr<UDataSystem> WeakThis(this);
+	DispatchWrite([delta, journal_path](int32& size)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Save Success"));
-		}
-		else
+			TArray<uint8> record;
+			FSaveFormat::WriteJournalRecord(delta.Get(), record);
+			TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*journal_path, FILEWRITE_Append));
+			if (Writer == nullptr)return false;
+			Writer->Serialize(record.GetData(), record.Num());
+			size = record.Num();
+			return Writer->Close();
+		}, [WeakThis](bool is_saved)
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Save Failed"));
-		}
+			//The changes are lost from the journal, a full save has them
+			if (!is_saved && WeakThis.IsValid())WeakThis->is_full_save_needed_ = true;
+		}, start_time, TEXT("Autosave"));
+}
+void UDataSystem::DispatchWrite(TFunction<bool(int32&)> write, TFunction<void(bool)> on_saved, double start_time, const TCHAR* kind)
+{
+	struct FSaveResult
+	{
+		bool is_saved_ = false;
+		int32 size_ = 0;
+	};
+	TSharedRef<FSaveResult, ESPMode::ThreadSafe> result = MakeShared<FSaveResult, ESPMode::ThreadSafe>();
+	double game_thread_time = FPlatformTime::Seconds() - start_time;
+	FGraphEventArray prerequisites;
+	if (is_saving())prerequisites.Add(save_task_);//Writes land in the order they are asked for
+	save_task_ = FFunctionGraphTask::CreateAndDispatchWhenReady([result, write = MoveTemp(write)]()
+		{
+			result->is_saved_ = write(result->size_);
+		}, GET_STATID(STAT_WriteSaveSlot), &prerequisites, ENamedThreads::AnyBackgroundThreadNormalTask);
+
+	FGraphEventArray written;
+	written.Add(save_task_);
+	TWeakObjectPtr<UDataSystem> WeakThis(this);
+	FString kind_name = kind;
+	FFunctionGraphTask::CreateAndDispatchWhenReady([WeakThis, result, start_time, game_thread_time, kind_name, on_saved = MoveTemp(on_saved)]()
+		{
+			if (result->is_saved_)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s Success, %d bytes, %.2f ms on the game thread, %.2f ms in all"), *kind_name, result->size_, game_thread_time * 1000.0, (FPlatformTime::Seconds() - start_time) * 1000.0);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s Failed"), *kind_name);
+			}
+			if (on_saved)on_saved(result->is_saved_);
+			if (result->is_saved_ && WeakThis.IsValid() && WeakThis->GetGameInstance() != nullptr)
+			{
+				UEventSystem* EventSystem = WeakThis->GetGameInstance()->GetSubsystem<UEventSystem>();
+				if (EventSystem)EventSystem->BroadcastEvent(EventSystem->OnGameSaved);
+			}
+		}, GET_STATID(STAT_SaveCompleted), &written, ENamedThreads::GameThread);
+	last_save_time_ = FPlatformTime::Seconds();
+}
+void UDataSystem::ClearJournal()
+{
+	for (int32 index : dirty_tiles_)
+	{
+		is_tile_dirty_[index] = false;
+	}
+	dirty_tiles_.Reset();
+	is_player_dirty_ = false;
+	is_full_save_needed_ = false;
+}
+bool UDataSystem::TickAutosave(float DeltaTime)
+{
+	float interval = CVarAutosaveInterval.GetValueOnGameThread();
+	if (interval > 0.0f && FPlatformTime::Seconds() - last_save_time_ >= interval)
+	{
+		last_save_time_ = FPlatformTime::Seconds();//Not again every check if there is no map yet
+		Autosave();
+	}
+	return true;
+}
+FString UDataSystem::GetJournalPath() const
+{
+	return USaveSlotManager::GetJournalPath(slot_name_);
+}
+void UDataSystem::SelectSlot(const FString& slot_name)
+{
+	if (slot_name == slot_name_)return;
+	WaitForSave();//The writes asked for go to the old slot
+	WaitForDecode();
+
+	slot_name_ = slot_name;
+	ApplySnapshot(FSaveSnapshot());//Cleared, in case the slot has no save
+	save_id_ = 0;
+	ClearJournal();
+	journal_record_count_ = 0;
+	is_full_save_needed_ = true;
+	LoadGame();
+	SyncLoadedTimeAndWeather();//Or the next clock step writes the time of the old slot over the loaded one
+}
+void UDataSystem::SyncLoadedTimeAndWeather()
+{
+	UTimeSystem* TimeSystem = GetGameInstance()->GetSubsystem<UTimeSystem>();
+	if (TimeSystem != nullptr)
+	{
+		TimeSystem->set_minute(minute_);
+		TimeSystem->set_hour(hour_);
+		TimeSystem->set_day_in_season(day_in_season_);
+		TimeSystem->set_season(present_season_);
 	}
+	UWeatherSystem* WeatherSystem = GetGameInstance()->GetSubsystem<UWeatherSystem>();
+	if (WeatherSystem != nullptr)WeatherSystem->set_weather(present_weather_);
 }
 void UDataSystem::LoadGame()
 {
-	UMySaveGame* LoadedGame = Cast<UMySaveGame>(UGameplayStatics::LoadGameFromSlot(TEXT("SavedGame"), 0));
-
-	if (LoadedGame)
-	{
-		// Retrieve and use the loaded data
-		set_minute(LoadedGame->minute_);
-		set_day_in_season(LoadedGame->day_in_season_);
-		set_present_season(LoadedGame->season_);
-		set_hour(LoadedGame->hour_);
-		set_real_time(LoadedGame->real_time_);//Time system data loaded
-		set_present_weather(LoadedGame->weather_);
-		set_present_base_temperature(LoadedGame->base_temperature_);// Weather system data loaded
-		set_ground_block_x_length(LoadedGame->ground_block_x_length_);
-		set_ground_block_y_length(LoadedGame->ground_block_y_length_);
-		set_ground_block_size(LoadedGame->ground_block_size_);
-		for (int i = 0; i < ground_block_x_length_ * ground_block_y_length_; i++)// Ground block data loaded
-		{
-			set_ground_block_type(i, LoadedGame->ground_block_type_[i]);
-			//set_ground_block_delta_temperature(i, LoadedGame->ground_block_delta_temperature_[i]);
-		}
-		set_is_items_initialized(LoadedGame->is_items_initialized_);
-		for (int i = 0; i < LoadedGame->item_block_lived_time_.Num(); i++)
+	TSharedRef<FSaveDecode, ESPMode::ThreadSafe> decode = MakeShared<FSaveDecode, ESPMode::ThreadSafe>();
+	if (!decode->Open(slot_name_))return;
+
+	double start_time = FPlatformTime::Seconds();
+	FSaveSnapshot& snapshot = decode->snapshot_;
+	if (FSaveFormat::IsSaveData(decode->bytes_, decode->size_))
+	{
+		if (!FSaveFormat::ReadMap(decode->bytes_, decode->size_, snapshot))
 		{
-			set_item_block_lived_time(i, LoadedGame->item_block_lived_time_[i]);
+			UE_LOG(LogTemp, Error, TEXT("DataSystem.cpp: LoadGame: Failed to read the save, a new game is started"));
+			return;
 		}
-		for (int i = 0; i < LoadedGame->item_block_durability_.Num(); i++)
+	}
+	else
+	{
+		//A slot of the old UMySaveGame
+		TArray<uint8> data(decode->bytes_, decode->size_);
+		UMySaveGame* LoadedGame = Cast<UMySaveGame>(UGameplayStatics::LoadGameFromMemory(data));
+		if (LoadedGame == nullptr)return;
+		FSaveFormat::ReadLegacy(LoadedGame, snapshot);
+	}
+	TArray<uint8> journal;
+	int32 record_count = 0;
+	bool is_journal_complete = true;
+	if (snapshot.save_id_ != 0 && FFileHelper::LoadFileToArray(journal, *GetJournalPath(), FILEREAD_Silent))
+	{
+		record_count = FSaveFormat::ReadJournal(journal, snapshot, is_journal_complete);
+	}
+	ApplySnapshot(snapshot);//The layers of a save with chunks are empty, the chunks are decoded into the tile store
+	//What is on the disk is the state now, the next autosave follows it
+	save_id_ = snapshot.save_id_;
+	ClearJournal();
+	journal_record_count_ = record_count;
+	//Records appended after a damaged one would never be read, the next save replaces the journal
+	is_full_save_needed_ = save_id_ == 0 || !is_journal_complete;
+	if (!is_journal_complete)UE_LOG(LogTemp, Warning, TEXT("DataSystem.cpp: LoadGame: The journal ends in a damaged record, the next save is a full save"));
+	if (snapshot.chunk_index_.Num() > 0)
+	{
+		StartDecode(decode);
+	}
+	else
+	{
+		decode->Close();
+	}
+	UE_LOG(LogTemp, Warning, TEXT("Load Success, %lld bytes and %d journal records in %.2f ms"), decode->size_, record_count, (FPlatformTime::Seconds() - start_time) * 1000.0);
+}
+void UDataSystem::StartDecode(TSharedRef<FSaveDecode, ESPMode::ThreadSafe> decode)
+{
+	decode_start_time_ = FPlatformTime::Seconds();
+	const FSaveChunkIndex& chunk_index = decode->snapshot_.chunk_index_;
+	decode->tiles_ = &tiles_;
+	decode->chunk_state_.Init(FSaveDecode::kNotDecoded, chunk_index.Num());
+	decode->pending_tiles_.SetNum(chunk_index.Num());
+	for (const FSaveTile& tile : decode->snapshot_.pending_tiles_)
+	{
+		int32 x = tile.index_ / tiles_.get_y_length();
+		int32 y = tile.index_ % tiles_.get_y_length();
+		decode->pending_tiles_[x / chunk_index.chunk_length_ * chunk_index.chunk_y_count_ + y / chunk_index.chunk_length_].Add(tile);
+	}
+	decode->snapshot_.pending_tiles_.Empty();
+	decode_ = decode;
+
+	//The chunks around the player now, the world is built there first
+	if (player_chunk_x_ >= 0 && player_chunk_y_ >= 0)
+	{
+		DecodeTiles((player_chunk_x_ - kDecodeRadius) * chunk_size_, (player_chunk_y_ - kDecodeRadius) * chunk_size_,
+			(player_chunk_x_ + kDecodeRadius + 1) * chunk_size_ - 1, (player_chunk_y_ + kDecodeRadius + 1) * chunk_size_ - 1);
+	}
+
+	//The rest on a worker, the chunks decoded on demand meanwhile are skipped
+	decode_task_ = FFunctionGraphTask::CreateAndDispatchWhenReady([decode]()
 		{
-			set_item_block_durability(i, LoadedGame->item_block_durability_[i]);
-		}
-		for (int i = 0; i < LoadedGame->is_item_block_watered_.Num(); i++)
+			ParallelFor(decode->chunk_state_.Num(), [&decode](int32 chunk)
+				{
+					decode->DecodeChunk(chunk);
+				});
+			decode->Close();
+		}, GET_STATID(STAT_DecodeSave), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+	FGraphEventArray decoded;
+	decoded.Add(decode_task_);
+	TWeakObjectPtr<UDataSystem> WeakThis(this);
+	TWeakPtr<FSaveDecode, ESPMode::ThreadSafe> WeakDecode(decode);
+	FFunctionGraphTask::CreateAndDispatchWhenReady([WeakThis, WeakDecode]()
 		{
-			set_is_item_block_watered(i, LoadedGame->is_item_block_watered_[i]);
-		}
-		for (int i = 0; i < LoadedGame->item_block_id_.Num(); i++)// Item block data loaded
+			//A slot loaded since has a decode of its own, it is not finished by this one
+			if (WeakThis.IsValid() && WeakThis->decode_.IsValid() && WeakThis->decode_ == WeakDecode.Pin())WeakThis->FinishDecode();
+		}, GET_STATID(STAT_SaveDecoded), &decoded, ENamedThreads::GameThread);
+}
+void UDataSystem::DecodeTiles(int32 x_begin, int32 y_begin, int32 x_end, int32 y_end)
+{
+	if (!decode_.IsValid())return;
+	const FSaveChunkIndex& chunk_index = decode_->snapshot_.chunk_index_;
+	x_begin = FMath::Max(x_begin, 0) / chunk_index.chunk_length_;
+	y_begin = FMath::Max(y_begin, 0) / chunk_index.chunk_length_;
+	x_end = FMath::Min(x_end / chunk_index.chunk_length_, chunk_index.chunk_x_count_ - 1);
+	y_end = FMath::Min(y_end / chunk_index.chunk_length_, chunk_index.chunk_y_count_ - 1);
+	for (int32 chunk_x = x_begin; chunk_x <= x_end; chunk_x++)
+		for (int32 chunk_y = y_begin; chunk_y <= y_end; chunk_y++)
 		{
-			set_item_block_id(i, LoadedGame->item_block_id_[i]);
+			decode_->DecodeChunk(chunk_x * chunk_index.chunk_y_count_ + chunk_y);
 		}
-		set_player_axe_level(LoadedGame->player_axe_level_);
-		set_player_hoe_level(LoadedGame->player_hoe_level_);
-		set_player_scythe_level(LoadedGame->player_scythe_level_);
-		set_player_axe_exp(LoadedGame->player_axe_exp_);
-		set_player_hoe_exp(LoadedGame->player_hoe_exp_);
-		set_player_scythe_exp(LoadedGame->player_scythe_exp_);
-		for (auto it : LoadedGame->player_bag_)// Player system data loaded
-		{
-			player_bag_.Add(it);
+}
+bool UDataSystem::IsTilesDecoded(int32 x_begin, int32 y_begin, int32 x_end, int32 y_end) const
+{
+	if (!decode_.IsValid())return true;
+	const FSaveChunkIndex& chunk_index = decode_->snapshot_.chunk_index_;
+	x_begin = FMath::Max(x_begin, 0) / chunk_index.chunk_length_;
+	y_begin = FMath::Max(y_begin, 0) / chunk_index.chunk_length_;
+	x_end = FMath::Min(x_end / chunk_index.chunk_length_, chunk_index.chunk_x_count_ - 1);
+	y_end = FMath::Min(y_end / chunk_index.chunk_length_, chunk_index.chunk_y_count_ - 1);
+	for (int32 chunk_x = x_begin; chunk_x <= x_end; chunk_x++)
+		for (int32 chunk_y = y_begin; chunk_y <= y_end; chunk_y++)
+		{
+			if (FPlatformAtomics::AtomicRead(&decode_->chunk_state_[chunk_x * chunk_index.chunk_y_count_ + chunk_y]) != FSaveDecode::kDecoded)return false;
 		}
+	return true;
+}
+void UDataSystem::WaitForDecode()
+{
+	if (decode_task_.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(decode_task_, ENamedThreads::GameThread);
 	}
+	FinishDecode();
+}
+void UDataSystem::FinishDecode()
+{
+	if (!decode_.IsValid())return;
+	int32 damaged_count = decode_->damaged_count_.GetValue();
+	if (damaged_count > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("DataSystem.cpp: FinishDecode: %d chunks of the save are damaged, their blocks are empty"), damaged_count);
+	}
+	UE_LOG(LogTemp, Warning, TEXT("Decoded %d chunks in %.2f ms"), decode_->chunk_state_.Num(), (FPlatformTime::Seconds() - decode_start_time_) * 1000.0);
+	decode_ = nullptr;
+	decode_task_ = nullptr;
+}
+
+void UDataSystem::TakeSnapshot(FSaveSnapshot& snapshot)
+{
+	WaitForDecode();//A full save holds every block
+	snapshot.minute_ = minute_;
+	snapshot.hour_ = hour_;
+	snapshot.day_in_season_ = day_in_season_;
+	snapshot.season_ = present_season_;
+	snapshot.real_time_ = real_time_;//Time system data
+	snapshot.weather_ = present_weather_;
+	snapshot.base_temperature_ = present_base_temperature_;//Weather system data
+	snapshot.x_length_ = tiles_.get_x_length();
+	snapshot.y_length_ = tiles_.get_y_length();
+	snapshot.ground_block_size_ = ground_block_size_;
+	snapshot.map_seed_ = map_seed_;
+	snapshot.is_items_initialized_ = is_items_initialized_;
+	snapshot.ground_type_ = tiles_.ground_type_;
+	snapshot.delta_temperature_ = tiles_.delta_temperature_;
+	snapshot.is_temperature_saved_ = is_temperature_initialized_;//Ground block data
+	snapshot.item_id_ = tiles_.item_id_;
+	snapshot.lived_time_ = tiles_.lived_time_;
+	snapshot.durability_ = tiles_.durability_;
+	snapshot.is_watered_ = tiles_.is_watered_;//Item block data
+	snapshot.player_axe_level_ = player_axe_level_;
+	snapshot.player_hoe_level_ = player_hoe_level_;
+	snapshot.player_scythe_level_ = player_scythe_level_;
+	snapshot.player_axe_exp_ = player_axe_exp_;
+	snapshot.player_hoe_exp_ = player_hoe_exp_;
+	snapshot.player_scythe_exp_ = player_scythe_exp_;
+	snapshot.player_bag_ = player_bag_;
+	snapshot.player_chunk_x_ = player_chunk_x_;
+	snapshot.player_chunk_y_ = player_chunk_y_;//Player system data
+}
+
+void UDataSystem::ApplySnapshot(const FSaveSnapshot& snapshot)
+{
+	set_minute(snapshot.minute_);
+	set_hour(snapshot.hour_);
+	set_day_in_season(snapshot.day_in_season_);
+	set_present_season(snapshot.season_);
+	set_real_time(snapshot.real_time_);//Time system data loaded
+	set_present_weather(snapshot.weather_);
+	set_present_base_temperature(snapshot.base_temperature_);//Weather system data loaded
+	set_ground_block_lengths(snapshot.x_length_, snapshot.y_length_);
+	set_ground_block_size(snapshot.ground_block_size_);
+	set_map_seed(snapshot.map_seed_);
+	set_is_items_initialized(snapshot.is_items_initialized_);
+	FTileStore::CopyLayer(tiles_.ground_type_, snapshot.ground_type_);
+	FTileStore::CopyLayer(tiles_.delta_temperature_, snapshot.delta_temperature_);
+	set_is_temperature_initialized(snapshot.is_temperature_saved_);//Ground block data loaded
+	FTileStore::CopyLayer(tiles_.item_id_, snapshot.item_id_);
+	FTileStore::CopyLayer(tiles_.lived_time_, snapshot.lived_time_);
+	FTileStore::CopyLayer(tiles_.durability_, snapshot.durability_);
+	FTileStore::CopyLayer(tiles_.is_watered_, snapshot.is_watered_);//Item block data loaded
+	set_player_axe_level(snapshot.player_axe_level_);
+	set_player_hoe_level(snapshot.player_hoe_level_);
+	set_player_scythe_level(snapshot.player_scythe_level_);
+	set_player_axe_exp(snapshot.player_axe_exp_);
+	set_player_hoe_exp(snapshot.player_hoe_exp_);
+	set_player_scythe_exp(snapshot.player_scythe_exp_);
+	player_bag_ = snapshot.player_bag_;
+	set_player_chunk(snapshot.player_chunk_x_, snapshot.player_chunk_y_);//Player system data loaded
 }
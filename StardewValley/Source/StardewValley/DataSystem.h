@@ -10,10 +10,15 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
-#include "GroundBlockBase.h"
 #include "ItemBlockBase.h"
+#include "GroundType.h"
+#include "TileStore.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "DataSystem.generated.h"
 
+struct FSaveSnapshot;
+struct FSaveDecode;
+
  /**
   *
   */
@@ -24,20 +29,33 @@ class STARDEWVALLEY_API UDataSystem : public UGameInstanceSubsystem
 	/*-----------------------------Variables-----------------------------*/
 private:
 	//Ground block data
-	int32 ground_block_x_length_;
-	int32 ground_block_y_length_;
 	int32 ground_block_size_;
-	TArray<AGroundBlockBase*> ground_blocks_;
-	TArray<FString> ground_block_type_;
-	TArray<int32> ground_block_delta_temperature_;
 private:
-	//Item block data
-	TArray<AItemBlockBase*> item_blocks_;
-	TArray<int32> item_block_id_;
-	TArray<int32> item_block_lived_time_;
-	TArray<int32> item_block_durability_;
-	TArray<bool> is_item_block_watered_;
+	//Data of each block, sized once by set_ground_block_lengths
+	FTileStore tiles_;
 	bool is_items_initialized_;
+	bool is_temperature_initialized_;//The fires have warmed the ground, or the temperature is loaded
+	int32 map_seed_;//The seed the map was generated from
+	FString slot_name_;//The slot saved to and loaded from
+private:
+	//Lazy decoding of the loaded save. The blocks of a chunk are only valid once it is decoded
+	TSharedPtr<FSaveDecode, ESPMode::ThreadSafe> decode_;//Null once every chunk is decoded
+	FGraphEventRef decode_task_;//Decodes the chunks left on a worker
+	double decode_start_time_;
+private:
+	//Change journal, what has changed since the last save. Autosaves write only this.
+	TBitArray<> is_tile_dirty_;
+	TArray<int32> dirty_tiles_;
+	bool is_player_dirty_;
+	bool is_full_save_needed_;//A change the journal does not hold, e.g. a new map
+	uint32 save_id_;//Of the last full save, the journal records after it carry it
+	int32 journal_record_count_;
+	double last_save_time_;
+	FDelegateHandle autosave_ticker_;
+private:
+	//Chunk data, the map is streamed chunk by chunk around the player
+	int32 chunk_size_;
+	TArray<bool> is_chunk_loaded_;
 private:
 	//Time data
 	int32 present_season_;
@@ -58,6 +76,8 @@ private:
 	int32 player_hoe_exp_;
 	int32 player_scythe_exp_;
 	TMap<int32, int32> player_bag_;
+	int32 player_chunk_x_;//The chunk the player is in, -1 if unknown
+	int32 player_chunk_y_;
 	/*-----------------------------Getters-----------------------------*/
 public:
 	//Time data getters
@@ -69,27 +89,45 @@ public:
 public:
 	//Ground block data getters
 	int32 get_ground_block_size() { return ground_block_size_; };
-	int32 get_ground_block_x_length() { return ground_block_x_length_; };
-	int32 get_ground_block_y_length() { return ground_block_y_length_; };
-	FString get_ground_block_type(int32 index) { if (index < ground_block_type_.Num() && index >= 0)return ground_block_type_[index]; else return ""; };
-	FString get_ground_block_type(int32 x, int32 y) { if (x * ground_block_y_length_ + y < ground_block_type_.Num() && x * ground_block_y_length_ + y >= 0)return ground_block_type_[x * ground_block_y_length_ + y]; else return ""; };
-	int32 get_ground_block_delta_temperature(int32 index) { if (index < ground_block_delta_temperature_.Num() && index >= 0)return ground_block_delta_temperature_[index]; else return 0; };
-	int32 get_ground_block_delta_temperature(int32 x, int32 y) { if (x * ground_block_y_length_ + y < ground_block_delta_temperature_.Num() && x * ground_block_y_length_ + y >= 0)return ground_block_delta_temperature_[x * ground_block_y_length_ + y]; else return 0; };
-	AGroundBlockBase* get_ground_block(int32 index) { if (index < ground_blocks_.Num() && index >= 0)return ground_blocks_[index]; else return nullptr; };
-	AGroundBlockBase* get_ground_block(int32 x, int32 y) { if (x * ground_block_y_length_ + y < ground_blocks_.Num() && x * ground_block_y_length_ + y >= 0)return ground_blocks_[x * ground_block_y_length_ + y]; else return nullptr; };
+	int32 get_ground_block_x_length() { return tiles_.get_x_length(); };
+	int32 get_ground_block_y_length() { return tiles_.get_y_length(); };
+	EGroundType get_ground_block_type(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.ground_type_, index); else return EGroundType::None; };
+	EGroundType get_ground_block_type(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.ground_type_, tiles_.Index(x, y)); else return EGroundType::None; };
+	int32 get_ground_block_delta_temperature(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.delta_temperature_, index); else return 0; };
+	int32 get_ground_block_delta_temperature(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.delta_temperature_, tiles_.Index(x, y)); else return 0; };
+	bool is_ground_block_exist(int32 x, int32 y) { return get_ground_block_type(x, y) != EGroundType::None; };
 public:
 	//Item block data getters
-	AItemBlockBase* get_item_block(int32 index) { if (index < item_blocks_.Num() && index >= 0)return item_blocks_[index]; else return nullptr; };
-	AItemBlockBase* get_item_block(int32 x, int32 y) { if (x * ground_block_y_length_ + y < item_blocks_.Num() && x * ground_block_y_length_ + y >= 0)return item_blocks_[x * ground_block_y_length_ + y]; else return nullptr; };
-	int32 get_item_block_id(int32 index) { if (index < item_block_id_.Num() && index >= 0)return item_block_id_[index]; else return -1; };
-	int32 get_item_block_id(int32 x, int32 y) { if (x * ground_block_y_length_ + y < item_block_id_.Num() && x * ground_block_y_length_ + y >= 0)return item_block_id_[x * ground_block_y_length_ + y]; else return -1; };
-	int32 get_item_block_lived_time(int32 index) { if (index < item_block_lived_time_.Num() && index >= 0)return item_block_lived_time_[index]; else return -1; };
-	int32 get_item_block_lived_time(int32 x, int32 y) { if (x * ground_block_y_length_ + y < item_block_lived_time_.Num() && x * ground_block_y_length_ + y >= 0)return item_block_lived_time_[x * ground_block_y_length_ + y]; else return -1; };
-	int32 get_item_block_durability(int32 index) { if (index < item_block_durability_.Num() && index >= 0)return item_block_durability_[index]; else return -1; };
-	int32 get_item_block_durability(int32 x, int32 y) { if (x * ground_block_y_length_ + y < item_block_durability_.Num() && x * ground_block_y_length_ + y >= 0)return item_block_durability_[x * ground_block_y_length_ + y]; else return -1; };
-	bool get_is_item_block_watered(int32 index) { if (index < is_item_block_watered_.Num() && index >= 0)return is_item_block_watered_[index]; else return false; };
-	bool get_is_item_block_watered(int32 x, int32 y) { if (x * ground_block_y_length_ + y < is_item_block_watered_.Num() && x * ground_block_y_length_ + y >= 0)return is_item_block_watered_[x * ground_block_y_length_ + y]; else return false; };
+	AItemBlockBase* get_item_block(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.item_block_, index); else return nullptr; };
+	AItemBlockBase* get_item_block(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.item_block_, tiles_.Index(x, y)); else return nullptr; };
+	int32 get_item_block_id(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.item_id_, index); else return -1; };
+	int32 get_item_block_id(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.item_id_, tiles_.Index(x, y)); else return -1; };
+	int32 get_item_block_lived_time(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.lived_time_, index); else return -1; };
+	int32 get_item_block_lived_time(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.lived_time_, tiles_.Index(x, y)); else return -1; };
+	int32 get_item_block_durability(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.durability_, index); else return -1; };
+	int32 get_item_block_durability(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.durability_, tiles_.Index(x, y)); else return -1; };
+	bool get_is_item_block_watered(int32 index) { if (tiles_.IsValidIndex(index))return FTileStore::At(tiles_.is_watered_, index); else return false; };
+	bool get_is_item_block_watered(int32 x, int32 y) { if (tiles_.IsValidIndex(x, y))return FTileStore::At(tiles_.is_watered_, tiles_.Index(x, y)); else return false; };
 	bool is_items_initialized() { return is_items_initialized_; };
+	bool is_temperature_initialized() { return is_temperature_initialized_; };
+	int32 get_map_seed() { return map_seed_; };
+public:
+	//Chunk data getters
+	int32 get_chunk_size() { return chunk_size_; };
+	int32 get_chunk_x_count() { return (get_ground_block_x_length() + chunk_size_ - 1) / chunk_size_; };
+	int32 get_chunk_y_count() { return (get_ground_block_y_length() + chunk_size_ - 1) / chunk_size_; };
+	bool get_is_chunk_loaded(int32 chunk_x, int32 chunk_y) { if (chunk_x >= 0 && chunk_y >= 0 && chunk_x < get_chunk_x_count() && chunk_y < get_chunk_y_count() && is_chunk_loaded_.IsValidIndex(chunk_x * get_chunk_y_count() + chunk_y))return is_chunk_loaded_[chunk_x * get_chunk_y_count() + chunk_y]; else return false; };
+	bool get_is_tile_loaded(int32 x, int32 y) { return get_is_chunk_loaded(x / chunk_size_, y / chunk_size_); };
+public:
+	//Unchecked block data access, the index must be valid. For loops over the whole map.
+	FTileStore& get_tiles() { return tiles_; };
+	EGroundType get_ground_block_type_unchecked(int32 index) { return FTileStore::At(tiles_.ground_type_, index); };
+	int32 get_ground_block_delta_temperature_unchecked(int32 index) { return FTileStore::At(tiles_.delta_temperature_, index); };
+	AItemBlockBase* get_item_block_unchecked(int32 index) { return FTileStore::At(tiles_.item_block_, index); };
+	int32 get_item_block_id_unchecked(int32 index) { return FTileStore::At(tiles_.item_id_, index); };
+	int32 get_item_block_lived_time_unchecked(int32 index) { return FTileStore::At(tiles_.lived_time_, index); };
+	int32 get_item_block_durability_unchecked(int32 index) { return FTileStore::At(tiles_.durability_, index); };
+	bool get_is_item_block_watered_unchecked(int32 index) { return FTileStore::At(tiles_.is_watered_, index); };
 public:
 	//Weather data getters
 	int32 get_present_weather() { return present_weather_; };
@@ -104,6 +142,8 @@ public:
 	int32 get_player_scythe_exp() { return player_scythe_exp_; };
 	int32 get_amount_of_item_in_bag(int32 index) { if (player_bag_.Contains(index))return player_bag_[index]; else return 0; };
 	TMap<int32, int32> get_player_bag() { return player_bag_; };
+	int32 get_player_chunk_x() { return player_chunk_x_; };
+	int32 get_player_chunk_y() { return player_chunk_y_; };
 	/*-----------------------------Setters-----------------------------*/
 public:
 	//Time data setters
@@ -119,53 +159,165 @@ public:
 public:
 	//Ground block data setters
 	void set_ground_block_size(int32 size) { ground_block_size_ = size; };
-	void set_ground_block_x_length(int32 length) { ground_block_x_length_ = length; };
-	void set_ground_block_y_length(int32 length) { ground_block_y_length_ = length; };
-	void set_ground_block_type(int32 index, FString type) { while (ground_block_type_.Num() <= index) { ground_block_type_.Add(""); }; ground_block_type_[index] = type; };
-	void set_ground_block_type(int32 x, int32 y, FString type) { set_ground_block_type(x * ground_block_y_length_ + y, type); };
-	void set_ground_block_delta_temperature(int32 index, int32 delta_temperature) { while (ground_block_delta_temperature_.Num() <= index) { ground_block_delta_temperature_.Add(0); }; ground_block_delta_temperature_[index] = delta_temperature; };
-	void set_ground_block_delta_temperature(int32 x, int32 y, int32 delta_temperature) { set_ground_block_delta_temperature(x * ground_block_y_length_ + y, delta_temperature); };
-	void set_ground_block(int32 index, AGroundBlockBase* block) { while (ground_blocks_.Num() <= index) { ground_blocks_.Add(nullptr); }; ground_blocks_[index] = block; };
-	void set_ground_block(int32 x, int32 y, AGroundBlockBase* block) { set_ground_block(x * ground_block_y_length_ + y, block); };
+	/**
+	 * \brief Set the size of the map. Every block is cleared if the size changes.
+	 *
+	 * \param x_length The number of blocks in x direction
+	 * \param y_length The number of blocks in y direction
+	 */
+	void set_ground_block_lengths(int32 x_length, int32 y_length);
+	void set_ground_block_type(int32 index, EGroundType type) { if (tiles_.IsValidIndex(index)) { FTileStore::At(tiles_.ground_type_, index) = type; MarkTileDirty(index); } };
+	void set_ground_block_type(int32 x, int32 y, EGroundType type) { if (tiles_.IsValidIndex(x, y)) { FTileStore::At(tiles_.ground_type_, tiles_.Index(x, y)) = type; MarkTileDirty(tiles_.Index(x, y)); } };
+	void set_ground_block_delta_temperature(int32 index, int32 delta_temperature) { if (tiles_.IsValidIndex(index)) { FTileStore::At(tiles_.delta_temperature_, index) = delta_temperature; MarkTileDirty(index); } };
+	void set_ground_block_delta_temperature(int32 x, int32 y, int32 delta_temperature) { if (tiles_.IsValidIndex(x, y)) { FTileStore::At(tiles_.delta_temperature_, tiles_.Index(x, y)) = delta_temperature; MarkTileDirty(tiles_.Index(x, y)); } };
 public:
 	//Item block data setters
-	void set_item_block(int32 index, AItemBlockBase* block) { while (item_blocks_.Num() <= index) { item_blocks_.Add(nullptr); }; item_blocks_[index] = block; };
-	void set_item_block(int32 x, int32 y, AItemBlockBase* block) { set_item_block(x * ground_block_y_length_ + y, block); };
-	void set_item_block_id(int32 index, int32 id) { while (item_block_id_.Num() <= index) { item_block_id_.Add(-1); }; item_block_id_[index] = id; };
-	void set_item_block_id(int32 x, int32 y, int32 id) { set_item_block_id(x * ground_block_y_length_ + y, id); };
-	void set_item_block_lived_time(int32 index, int32 status) { while (item_block_lived_time_.Num() <= index) { item_block_lived_time_.Add(-1); }; item_block_lived_time_[index] = status; };
-	void set_item_block_lived_time(int32 x, int32 y, int32 status) { set_item_block_lived_time(x * ground_block_y_length_ + y, status); };
-	void set_item_block_durability(int32 index, int32 durability) { while (item_block_durability_.Num() <= index) { item_block_durability_.Add(-1); }; item_block_durability_[index] = durability; };
-	void set_item_block_durability(int32 x, int32 y, int32 durability) { set_item_block_durability(x * ground_block_y_length_ + y, durability); };
-	void set_is_item_block_watered(int32 index, bool is_watered) { while (is_item_block_watered_.Num() <= index) { is_item_block_watered_.Add(false); }; is_item_block_watered_[index] = is_watered; };
-	void set_is_item_block_watered(int32 x, int32 y, bool is_watered) { set_is_item_block_watered(x * ground_block_y_length_ + y, is_watered); };
+	void set_item_block(int32 index, AItemBlockBase* block) { if (tiles_.IsValidIndex(index))FTileStore::At(tiles_.item_block_, index) = block; };
+	void set_item_block(int32 x, int32 y, AItemBlockBase* block) { if (tiles_.IsValidIndex(x, y))FTileStore::At(tiles_.item_block_, tiles_.Index(x, y)) = block; };
+	void set_item_block_id(int32 index, int32 id) { if (tiles_.IsValidIndex(index)) { FTileStore::At(tiles_.item_id_, index) = id; MarkTileDirty(index); } };
+	void set_item_block_id(int32 x, int32 y, int32 id) { if (tiles_.IsValidIndex(x, y)) { FTileStore::At(tiles_.item_id_, tiles_.Index(x, y)) = id; MarkTileDirty(tiles_.Index(x, y)); } };
+	void set_item_block_lived_time(int32 index, int32 status) { if (tiles_.IsValidIndex(index)) { FTileStore::At(tiles_.lived_time_, index) = status; MarkTileDirty(index); } };
+	void set_item_block_lived_time(int32 x, int32 y, int32 status) { if (tiles_.IsValidIndex(x, y)) { FTileStore::At(tiles_.lived_time_, tiles_.Index(x, y)) = status; MarkTileDirty(tiles_.Index(x, y)); } };
+	void set_item_block_durability(int32 index, int32 durability) { if (tiles_.IsValidIndex(index)) { FTileStore::At(tiles_.durability_, index) = durability; MarkTileDirty(index); } };
+	void set_item_block_durability(int32 x, int32 y, int32 durability) { if (tiles_.IsValidIndex(x, y)) { FTileStore::At(tiles_.durability_, tiles_.Index(x, y)) = durability; MarkTileDirty(tiles_.Index(x, y)); } };
+	void set_is_item_block_watered(int32 index, bool is_watered) { if (tiles_.IsValidIndex(index)) { FTileStore::At(tiles_.is_watered_, index) = is_watered; MarkTileDirty(index); } };
+	void set_is_item_block_watered(int32 x, int32 y, bool is_watered) { if (tiles_.IsValidIndex(x, y)) { FTileStore::At(tiles_.is_watered_, tiles_.Index(x, y)) = is_watered; MarkTileDirty(tiles_.Index(x, y)); } };
 	void set_is_items_initialized(bool is_initialized) { is_items_initialized_ = is_initialized; };
+	void set_is_temperature_initialized(bool is_initialized) { is_temperature_initialized_ = is_initialized; };
+	void set_map_seed(int32 seed) { map_seed_ = seed; };
+public:
+	//Change journal setters
+	/**
+	 * \brief Record that a block has changed, for the next autosave. The setters call it, code writing the layers of get_tiles() must call it too.
+	 *
+	 * \param index The index of the block
+	 */
+	void MarkTileDirty(int32 index) { if (is_tile_dirty_.IsValidIndex(index) && !is_tile_dirty_[index]) { is_tile_dirty_[index] = true; dirty_tiles_.Add(index); } };
+	/**
+	 * \brief Record that most of the map has changed, the next autosave is a full save.
+	 */
+	void MarkAllTilesDirty() { is_full_save_needed_ = true; };
+public:
+	//Chunk data setters
+	void set_is_chunk_loaded(int32 chunk_x, int32 chunk_y, bool is_loaded) { int32 index = chunk_x * get_chunk_y_count() + chunk_y; if (chunk_x >= 0 && chunk_y >= 0 && chunk_x < get_chunk_x_count() && chunk_y < get_chunk_y_count() && is_chunk_loaded_.IsValidIndex(index))is_chunk_loaded_[index] = is_loaded; };
 public:
 	//Player data setters
-	void set_player_axe_level(int32 level) { player_axe_level_ = level; };
-	void set_player_hoe_level(int32 level) { player_hoe_level_ = level; };
-	void set_player_scythe_level(int32 level) { player_scythe_level_ = level; };
-	void set_player_axe_exp(int32 exp) { player_axe_exp_ = exp; };
-	void set_player_hoe_exp(int32 exp) { player_hoe_exp_ = exp; };
-	void set_player_scythe_exp(int32 exp) { player_scythe_exp_ = exp; };
+	void set_player_axe_level(int32 level) { player_axe_level_ = level; is_player_dirty_ = true; };
+	void set_player_hoe_level(int32 level) { player_hoe_level_ = level; is_player_dirty_ = true; };
+	void set_player_scythe_level(int32 level) { player_scythe_level_ = level; is_player_dirty_ = true; };
+	void set_player_axe_exp(int32 exp) { player_axe_exp_ = exp; is_player_dirty_ = true; };
+	void set_player_hoe_exp(int32 exp) { player_hoe_exp_ = exp; is_player_dirty_ = true; };
+	void set_player_scythe_exp(int32 exp) { player_scythe_exp_ = exp; is_player_dirty_ = true; };
 	void add_item_to_bag(int32 id, int32 amount) {
 		if (player_bag_.Contains(id)) { player_bag_[id] += amount; }
 		else { player_bag_.Add(id, amount); };
+		is_player_dirty_ = true;
 	}
+	void set_player_chunk(int32 chunk_x, int32 chunk_y) { player_chunk_x_ = chunk_x; player_chunk_y_ = chunk_y; };
 	/*-----------------------------Others-----------------------------*/
 public:
 	//Other functions
 	void Initialize(FSubsystemCollectionBase& Collection) override;
 	void Deinitialize() override;
 	/**
-	 * Saves the game.
+	 * \brief Save the game. Only the snapshot is taken on the game thread, it is encoded and written on a worker thread.
+	 * \brief Saves are written in the order they are asked for.
 	 *
+	 * \param on_saved Called on the game thread after the write, with whether it succeeded
+	 */
+	void SaveGame(TFunction<void(bool)> on_saved = nullptr);
+	/**
+	 * \brief Block until the saves asked for are written.
+	 */
+	void WaitForSave();
+	/**
+	 * \brief Save what has changed since the last save, appended to its journal. A full save is made instead
+	 * \brief if the journal has many records, most of the map has changed, or there is no full save to follow.
 	 */
-	void SaveGame();
+	void Autosave();
+	bool is_saving() { return save_task_.IsValid() && !save_task_->IsComplete(); };
 	/**
-	 * Loads the game.
+	 * Loads the game from the slot. Old UMySaveGame slots are converted.
+	 * Only the chunks around the saved player are decoded here, a worker decodes the rest.
 	 *
 	 */
 	void LoadGame();
+	/**
+	 * \brief Decode the chunks of the loaded save over the blocks [x_begin, x_end] x [y_begin, y_end] now, unless they are already.
+	 * \brief Call it before reading the blocks of a place the player has not been near, or wait for is_map_decoded.
+	 */
+	void DecodeTiles(int32 x_begin, int32 y_begin, int32 x_end, int32 y_end);
+	/**
+	 * \brief Block until every chunk of the loaded save is decoded. Needed before a loop over the whole map.
+	 */
+	void WaitForDecode();
+	bool is_map_decoded() { return !decode_.IsValid(); };
+	/**
+	 * \brief Whether every chunk of the loaded save over the blocks [x_begin, x_end] x [y_begin, y_end] is decoded. Does not wait.
+	 */
+	bool IsTilesDecoded(int32 x_begin, int32 y_begin, int32 x_end, int32 y_end) const;
+	/**
+	 * \brief Copy everything the save holds.
+	 *
+	 * \param snapshot Return value. The copy
+	 */
+	void TakeSnapshot(FSaveSnapshot& snapshot);
+	/**
+	 * \brief Replace the saved data with a snapshot.
+	 *
+	 * \param snapshot The data to use
+	 */
+	void ApplySnapshot(const FSaveSnapshot& snapshot);
+	/**
+	 * \brief Switch to another slot and load it, a slot without a save is a new game.
+	 * \brief Call it before the world is built, e.g. from the title screen. The current game is not saved.
+	 *
+	 * \param slot_name The name of the slot, see USaveSlotManager
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SelectSlot(const FString& slot_name);
+	/**
+	 * \brief Set the clock of the time system and the weather of the weather system to the loaded ones.
+	 * \brief They keep their own copies and write them back here, so this follows every load.
+	 */
+	void SyncLoadedTimeAndWeather();
+	const FString& get_slot_name() { return slot_name_; };
 	bool do_save;
+private:
+	/**
+	 * \brief Take a snapshot and write it as a new full save, which replaces the journal.
+	 */
+	void WriteFullSave(TFunction<void(bool)> on_saved);
+	/**
+	 * \brief Copy the dirty blocks and append them to the journal.
+	 */
+	void WriteJournalRecord();
+	/**
+	 * \brief Run a write on a worker thread after the writes before it, then report on the game thread.
+	 *
+	 * \param write Writes the save, returns whether it succeeded and the bytes written
+	 * \param on_saved Called on the game thread after the write
+	 * \param start_time When the save was asked for
+	 * \param kind The name of the save in the log
+	 */
+	void DispatchWrite(TFunction<bool(int32&)> write, TFunction<void(bool)> on_saved, double start_time, const TCHAR* kind);
+	/**
+	 * \brief Forget the changes, they are in the save now.
+	 */
+	void ClearJournal();
+	bool TickAutosave(float DeltaTime);
+	/**
+	 * \brief Start decoding the chunks of a save: the ones around the player now, the rest on a worker.
+	 */
+	void StartDecode(TSharedRef<FSaveDecode, ESPMode::ThreadSafe> decode);
+	/**
+	 * \brief Forget the decode once the worker is done. Called on the game thread.
+	 */
+	void FinishDecode();
+	FString GetJournalPath() const;
+
+	FGraphEventRef save_task_;//The last write, the next one waits for it
+	const int32 kMaxDirtyFraction = 8;//A full save is made if more than 1/8 of the blocks have changed
+	const float kAutosaveCheckPeriod = 1.0f;
+	const int32 kDecodeRadius = 2;//Chunks around the player decoded while loading, as many as the scene manager loads first
 };
@@ -0,0 +1,108 @@
+/*****************************************************************
+ * \file   EventQueue.h
+ * \brief  A queue of the calls to one event of the event system. The calls are kept in a ring buffer
+ * \brief  and broadcast together when the event system dispatches its queued events.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * The calls to an event with the given parameters. The ring buffer doubles when it is full.
+ * A call can be merged into a queued call with the same key, e.g. items of the same id.
+ */
+template <typename... ArgTypes>
+class TEventQueue
+{
+public:
+	/**
+	 * \brief Queue a call.
+	 */
+	void Push(ArgTypes... args)
+	{
+		Add(TTuple<ArgTypes...>(args...));
+	}
+	/**
+	 * \brief Queue a call, or merge it into the queued call with the same key.
+	 *
+	 * \param key The key of the call
+	 * \param merge Merges the call into the queued one
+	 */
+	template <typename MergeType>
+	void PushCoalesced(int32 key, MergeType merge, ArgTypes... args)
+	{
+		//The call is found by its number, the head moves on while a dispatch hands out the calls before it
+		if (const int64* number = coalesced_.Find(key))
+		{
+			if (*number >= dispatched_count_)
+			{
+				int32 position = static_cast<int32>(*number - dispatched_count_);
+				merge(calls_[(head_ + position) % calls_.Num()], TTuple<ArgTypes...>(args...));
+				return;
+			}
+		}
+		coalesced_.Add(key, dispatched_count_ + count_);
+		Add(TTuple<ArgTypes...>(args...));
+	}
+	/**
+	 * \brief Hand the queued calls to the handler in order. The calls queued meanwhile wait for the next dispatch.
+	 *
+	 * \param handler Called with the parameters of each call, e.g. broadcasts them
+	 * \return An int32, the number of calls handled
+	 */
+	template <typename HandlerType>
+	int32 Dispatch(HandlerType&& handler)
+	{
+		int32 dispatch_count = count_;
+		coalesced_.Reset();
+		for (int32 i = 0; i < dispatch_count; i++)
+		{
+			TTuple<ArgTypes...> call = MoveTemp(calls_[head_]);
+			head_ = (head_ + 1) % calls_.Num();
+			count_--;
+			dispatched_count_++;
+			call.ApplyAfter(handler);
+		}
+		return dispatch_count;
+	}
+	void Empty()
+	{
+		calls_.Empty();
+		coalesced_.Empty();
+		head_ = 0;
+		count_ = 0;
+	}
+	int32 Num() const { return count_; };
+	bool IsEmpty() const { return count_ == 0; };
+private:
+	void Add(TTuple<ArgTypes...>&& call)
+	{
+		if (count_ == calls_.Num())Grow();
+		calls_[(head_ + count_) % calls_.Num()] = MoveTemp(call);
+		count_++;
+	}
+	/**
+	 * \brief Double the ring buffer. The queued calls are moved to the front, so their positions from the head stay the same.
+	 */
+	void Grow()
+	{
+		TArray<TTuple<ArgTypes...>> calls;
+		calls.SetNum(FMath::Max(calls_.Num() * 2, kInitialCapacity));
+		for (int32 i = 0; i < count_; i++)
+		{
+			calls[i] = MoveTemp(calls_[(head_ + i) % calls_.Num()]);
+		}
+		calls_ = MoveTemp(calls);
+		head_ = 0;
+	}
+
+	TArray<TTuple<ArgTypes...>> calls_;
+	TMap<int32, int64> coalesced_;//Key -> number of the call, counted from the first call ever queued
+	int64 dispatched_count_ = 0;//The number of the call at the head
+	int32 head_ = 0;
+	int32 count_ = 0;
+	static constexpr int32 kInitialCapacity = 16;
+};
@@ -1,5 +1,550 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
+/*****************************************************************//**
+ * \file   EventSystem.cpp
+ * \brief  The implementation of the event system
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
 
 #include "EventSystem.h"
+#include "DataSystem.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Broadcasts"), STAT_EventBroadcasts, STATGROUP_EventSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bindings"), STAT_EventBindings, STATGROUP_EventSystem);
+
+static TAutoConsoleVariable<float> CVarEventHitchBudget(
+	TEXT("sv.EventHitchBudget"),
+	50.0f,
+	TEXT("A frame longer than this many milliseconds logs the events and listeners that took the most time in it. 0 turns it off."));
+
+
+void UEventSystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	is_running_ = true;
+	AddEventNames();
+	post_garbage_collect_handle_ = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &UEventSystem::OnPostGarbageCollect);
+}
+
+void UEventSystem::Deinitialize()
+{
+	Super::Deinitialize();
+
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(post_garbage_collect_handle_);
+	for (FEventBinding& binding : bindings_)
+	{
+		RemoveBinding(binding);
+	}
+	bindings_.Empty();
+	event_stats_.Empty();
+
+	//The listeners are going away, the queued events are dropped
+	is_running_ = false;
+	has_queued_events_ = false;
+	mowing_grass_ground_queue_.Empty();
+	ploughing_earth_ground_queue_.Empty();
+	placing_item_queue_.Empty();
+	tools_towards_item_block_queue_.Empty();
+	item_block_attacked_queue_.Empty();
+	water_crop_queue_.Empty();
+	given_items_queue_.Empty();
+	skill_exp_queue_.Empty();
+	tile_subscriptions_.Empty();
+	tile_buckets_.Empty();
+}
+
+void UEventSystem::Tick(float DeltaTime)
+{
+	//The stats gathered since the last tick belong to the frame that just ended
+	UpdateFrameStats(DeltaTime);
+	DispatchQueuedEvents();
+}
+
+ETickableTickType UEventSystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UEventSystem::GetTickableGameObjectWorld() const
+{
+	return GetGameInstance() ? GetGameInstance()->GetWorld() : nullptr;
+}
+
+TStatId UEventSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEventSystem, STATGROUP_Tickables);
+}
+
+void UEventSystem::PostMowingGrassGround(float x, float y)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastMowingGrassGround(x, y);
+		return;
+	}
+	mowing_grass_ground_queue_.Push(x, y);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostPloughingEarthGround(float x, float y)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastPloughingEarthGround(x, y);
+		return;
+	}
+	ploughing_earth_ground_queue_.Push(x, y);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostPlacingItem(int32 item_id, float x, float y)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastPlacingItem(item_id, x, y);
+		return;
+	}
+	placing_item_queue_.Push(item_id, x, y);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostToolsTowardsItemBlock(int32 tool_type, float x, float y)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastToolsTowardsItemBlock(tool_type, x, y);
+		return;
+	}
+	tools_towards_item_block_queue_.Push(tool_type, x, y);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostItemBlockAttacked(int32 interaction_type, int32 damage, float x, float y)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastEvent(OnItemBlockAttacked, interaction_type, damage, x, y);
+		return;
+	}
+	item_block_attacked_queue_.Push(interaction_type, damage, x, y);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostWaterCropAtGivenPosition(float x, float y)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastWaterCropAtGivenPosition(x, y);
+		return;
+	}
+	water_crop_queue_.Push(x, y);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostGivenItems(int32 item_id, int32 amount)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastEvent(OnGivenItems, item_id, amount);
+		return;
+	}
+	given_items_queue_.PushCoalesced(item_id, [](TTuple<int32, int32>& queued, const TTuple<int32, int32>& given)
+		{
+			queued.Get<1>() += given.Get<1>();
+		}, item_id, amount);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::PostSkillExpUpdate(int32 skill_type, int32 exp)
+{
+	if (!is_dispatch_deferred_ || !is_running_)
+	{
+		BroadcastEvent(OnSkillExpUpdate, skill_type, exp);
+		return;
+	}
+	skill_exp_queue_.PushCoalesced(skill_type, [](TTuple<int32, int32>& queued, const TTuple<int32, int32>& given)
+		{
+			queued.Get<1>() += given.Get<1>();
+		}, skill_type, exp);
+	has_queued_events_ = true;
+}
+
+void UEventSystem::DispatchQueuedEvents()
+{
+	for (int32 round = 0; round < kMaxDispatchRounds && has_queued_events_; round++)
+	{
+		has_queued_events_ = false;
+		//The input of the player
+		mowing_grass_ground_queue_.Dispatch([this](float x, float y) { BroadcastMowingGrassGround(x, y); });
+		ploughing_earth_ground_queue_.Dispatch([this](float x, float y) { BroadcastPloughingEarthGround(x, y); });
+		placing_item_queue_.Dispatch([this](int32 item_id, float x, float y) { BroadcastPlacingItem(item_id, x, y); });
+		tools_towards_item_block_queue_.Dispatch([this](int32 tool_type, float x, float y) { BroadcastToolsTowardsItemBlock(tool_type, x, y); });
+		//The effects on the map
+		item_block_attacked_queue_.Dispatch([this](int32 interaction_type, int32 damage, float x, float y) { BroadcastEvent(OnItemBlockAttacked, interaction_type, damage, x, y); });
+		water_crop_queue_.Dispatch([this](float x, float y) { BroadcastWaterCropAtGivenPosition(x, y); });
+		//The rewards
+		given_items_queue_.Dispatch([this](int32 item_id, int32 amount) { BroadcastEvent(OnGivenItems, item_id, amount); });
+		skill_exp_queue_.Dispatch([this](int32 skill_type, int32 exp) { BroadcastEvent(OnSkillExpUpdate, skill_type, exp); });
+	}
+}
+
+void UEventSystem::set_is_dispatch_deferred(bool is_dispatch_deferred)
+{
+	if (is_dispatch_deferred_ && !is_dispatch_deferred)DispatchQueuedEvents();
+	is_dispatch_deferred_ = is_dispatch_deferred;
+}
+
+void UEventSystem::UnsubscribeAll(const UObject* object)
+{
+	for (int32 i = bindings_.Num() - 1; i >= 0; i--)
+	{
+		if (bindings_[i].object_.Get(true) != object)continue;
+		RemoveBinding(bindings_[i]);
+		bindings_.RemoveAtSwap(i, 1, false);
+	}
+}
+
+int32 UEventSystem::RemoveStaleBindings()
+{
+	int32 removed_count = 0;
+	for (int32 i = bindings_.Num() - 1; i >= 0; i--)
+	{
+		if (bindings_[i].object_.IsValid())continue;
+		RemoveBinding(bindings_[i]);
+		bindings_.RemoveAtSwap(i, 1, false);
+		removed_count++;
+	}
+	//The sweep is amortized over the bindings added since
+	next_binding_sweep_ = FMath::Max(bindings_.Num() * 2, kMinBindingSweep);
+	return removed_count;
+}
+
+void UEventSystem::GetBindingCounts(FName event_name, int32& live_count, int32& stale_count) const
+{
+	live_count = 0;
+	stale_count = 0;
+	for (const FEventBinding& binding : bindings_)
+	{
+		if (binding.event_name_ != event_name)continue;
+		if (binding.object_.IsValid())live_count++;
+		else stale_count++;
+	}
+}
+
+void UEventSystem::LogBindingCounts() const
+{
+	TMap<FName, TPair<int32, int32>> counts;//Event -> live, stale
+	for (const FEventBinding& binding : bindings_)
+	{
+		TPair<int32, int32>& count = counts.FindOrAdd(binding.event_name_);
+		if (binding.object_.IsValid())count.Key++;
+		else count.Value++;
+	}
+	for (const TPair<FName, TPair<int32, int32>>& count : counts)
+	{
+		UE_LOG(LogTemp, Log, TEXT("EventSystem.cpp: LogBindingCounts: %s: %d live, %d stale"), *count.Key.ToString(), count.Value.Key, count.Value.Value);
+	}
+}
+
+void UEventSystem::OnPostGarbageCollect()
+{
+	RemoveStaleBindings();
+}
+
+int32 UEventSystem::SubscribeTileEvent(ETileEvent type, int32 x_begin, int32 y_begin, int32 x_end, int32 y_end, FTileEventDelegate callback)
+{
+	//Clipped to the map, a rectangle past it would fill buckets no tile is in
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	x_begin = FMath::Max(x_begin, 0);
+	y_begin = FMath::Max(y_begin, 0);
+	x_end = FMath::Min(x_end, DataSystem->get_ground_block_x_length() - 1);
+	y_end = FMath::Min(y_end, DataSystem->get_ground_block_y_length() - 1);
+	if (x_begin > x_end || y_begin > y_end)return INDEX_NONE;
+
+	FTileSubscription subscription;
+	subscription.callback_ = MoveTemp(callback);
+	subscription.type_ = type;
+	subscription.x_begin_ = x_begin;
+	subscription.y_begin_ = y_begin;
+	subscription.x_end_ = x_end;
+	subscription.y_end_ = y_end;
+	int32 handle = tile_subscriptions_.Add(MoveTemp(subscription));
+	ForEachBucketOf(tile_subscriptions_[handle], [&](const FIntPoint& bucket)
+		{
+			tile_buckets_.FindOrAdd(bucket).Add(handle);
+		});
+	return handle;
+}
+
+int32 UEventSystem::SubscribeChunkEvent(ETileEvent type, int32 chunk_x, int32 chunk_y, FTileEventDelegate callback)
+{
+	int32 chunk_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_chunk_size();
+	return SubscribeTileEvent(type, chunk_x * chunk_size, chunk_y * chunk_size, (chunk_x + 1) * chunk_size - 1, (chunk_y + 1) * chunk_size - 1, MoveTemp(callback));
+}
+
+void UEventSystem::UnsubscribeTileEvent(int32 subscription)
+{
+	if (!tile_subscriptions_.IsValidIndex(subscription))return;
+	ForEachBucketOf(tile_subscriptions_[subscription], [&](const FIntPoint& bucket)
+		{
+			TArray<int32>* subscriptions = tile_buckets_.Find(bucket);
+			if (subscriptions == nullptr)return;
+			subscriptions->RemoveSingleSwap(subscription, false);
+			if (subscriptions->Num() == 0)tile_buckets_.Remove(bucket);
+		});
+	tile_subscriptions_.RemoveAt(subscription);
+}
+
+void UEventSystem::UnsubscribeTileEvents(const UObject* object)
+{
+	TArray<int32> subscriptions;
+	for (auto it = tile_subscriptions_.CreateConstIterator(); it; ++it)
+	{
+		if (it->callback_.IsBoundToObject(object))subscriptions.Add(it.GetIndex());
+	}
+	for (int32 subscription : subscriptions)
+	{
+		UnsubscribeTileEvent(subscription);
+	}
+}
+
+void UEventSystem::PublishTileEvent(ETileEvent type, int32 x_index, int32 y_index, int32 value)
+{
+	if (x_index < 0 || y_index < 0)return;
+	const TArray<int32>* bucket = tile_buckets_.Find(FIntPoint(x_index / kTileBucketSize, y_index / kTileBucketSize));
+	if (bucket == nullptr)return;
+
+	//A callback may subscribe or unsubscribe, so the bucket is copied first
+	TArray<int32, TInlineAllocator<16>> subscriptions(*bucket);
+	for (int32 subscription : subscriptions)
+	{
+		if (!tile_subscriptions_.IsValidIndex(subscription))continue;
+		const FTileSubscription& tile_subscription = tile_subscriptions_[subscription];
+		if (tile_subscription.type_ != type
+			|| x_index < tile_subscription.x_begin_ || x_index > tile_subscription.x_end_
+			|| y_index < tile_subscription.y_begin_ || y_index > tile_subscription.y_end_)continue;
+		FTileEventDelegate callback = tile_subscription.callback_;
+		callback.ExecuteIfBound(type, x_index, y_index, value);
+	}
+}
+
+void UEventSystem::PublishTileEventAtLocation(ETileEvent type, float x, float y, int32 value)
+{
+	if (tile_subscriptions_.Num() == 0 || x < 0.0f || y < 0.0f)return;
+	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
+	if (block_size <= 0)return;
+	PublishTileEvent(type, static_cast<int32>(x / block_size), static_cast<int32>(y / block_size), value);
+}
+
+template <typename FuncType>
+void UEventSystem::ForEachBucketOf(const FTileSubscription& subscription, FuncType func) const
+{
+	for (int32 bucket_x = subscription.x_begin_ / kTileBucketSize; bucket_x <= subscription.x_end_ / kTileBucketSize; bucket_x++)
+	{
+		for (int32 bucket_y = subscription.y_begin_ / kTileBucketSize; bucket_y <= subscription.y_end_ / kTileBucketSize; bucket_y++)
+		{
+			func(FIntPoint(bucket_x, bucket_y));
+		}
+	}
+}
+
+void UEventSystem::BroadcastMowingGrassGround(float x, float y)
+{
+	BroadcastEvent(OnMowingGrassGround, x, y);
+	PublishTileEventAtLocation(ETileEvent::MowingGrassGround, x, y);
+}
+
+void UEventSystem::BroadcastPloughingEarthGround(float x, float y)
+{
+	BroadcastEvent(OnPloughingEarthGround, x, y);
+	PublishTileEventAtLocation(ETileEvent::PloughingEarthGround, x, y);
+}
+
+void UEventSystem::BroadcastPlacingItem(int32 item_id, float x, float y)
+{
+	BroadcastEvent(OnPlacingItem, item_id, x, y);
+	PublishTileEventAtLocation(ETileEvent::PlacingItem, x, y, item_id);
+}
+
+void UEventSystem::BroadcastToolsTowardsItemBlock(int32 tool_type, float x, float y)
+{
+	BroadcastEvent(OnToolsTowardsItemBlock, tool_type, x, y);
+	PublishTileEventAtLocation(ETileEvent::ToolsTowardsItemBlock, x, y, tool_type);
+}
+
+void UEventSystem::BroadcastWaterCropAtGivenPosition(float x, float y)
+{
+	BroadcastEvent(WaterCropAtGivenPosition, x, y);
+	PublishTileEventAtLocation(ETileEvent::WaterCrop, x, y);
+}
+
+void UEventSystem::RemoveBinding(FEventBinding& binding)
+{
+	binding.remove_(binding.handle_);
+	if (listener_stats_.IsValidIndex(binding.listener_))listener_stats_.RemoveAt(binding.listener_);
+}
+
+void UEventSystem::AddEventNames()
+{
+#define ADD_EVENT_NAME(Event) AddEventStats(&Event, TEXT(#Event))
+	ADD_EVENT_NAME(OnEarlyMorningBegin);
+	ADD_EVENT_NAME(OnMorningBegin);
+	ADD_EVENT_NAME(OnNoonBegin);
+	ADD_EVENT_NAME(OnAfternoonBegin);
+	ADD_EVENT_NAME(OnEveningBegin);
+	ADD_EVENT_NAME(OnNightBegin);
+	ADD_EVENT_NAME(OnSpringBegin);
+	ADD_EVENT_NAME(OnSummerBegin);
+	ADD_EVENT_NAME(OnAutumnBegin);
+	ADD_EVENT_NAME(OnWinterBegin);
+	ADD_EVENT_NAME(OnEightInMorning);
+	ADD_EVENT_NAME(OnEightInEvening);
+	ADD_EVENT_NAME(OnHourChanged);
+	ADD_EVENT_NAME(OnDayChanged);
+	ADD_EVENT_NAME(OnSeasonChanged);
+	ADD_EVENT_NAME(OnMinuteChanged);
+	ADD_EVENT_NAME(OnWeatherChanged);
+	ADD_EVENT_NAME(OnBaseTemperatureChanged);
+	ADD_EVENT_NAME(OnGroundGenerated);
+	ADD_EVENT_NAME(OnWorldReady);
+	ADD_EVENT_NAME(OnGameSaving);
+	ADD_EVENT_NAME(OnGameSaved);
+	ADD_EVENT_NAME(OnGrassGroundMowed);
+	ADD_EVENT_NAME(OnEarthGroundPloughed);
+	ADD_EVENT_NAME(WaterCropAtGivenPosition);
+	ADD_EVENT_NAME(OnItemBlockAttacked);
+	ADD_EVENT_NAME(OnGivenItems);
+	ADD_EVENT_NAME(OnUIMenuClosed);
+	ADD_EVENT_NAME(OnInterfaceChanged);
+	ADD_EVENT_NAME(OnExitGame);
+	ADD_EVENT_NAME(OnReturnTitle);
+	ADD_EVENT_NAME(OnAnExpBarFull);
+	ADD_EVENT_NAME(OnItemAddedToShortcutBar);
+	ADD_EVENT_NAME(OnItemRemovedFromShortcutBar);
+	ADD_EVENT_NAME(OnCallingMenu);
+	ADD_EVENT_NAME(OnShortcutSelected);
+	ADD_EVENT_NAME(OnToolsTowardsItemBlock);
+	ADD_EVENT_NAME(OnPlacingItem);
+	ADD_EVENT_NAME(OnMowingGrassGround);
+	ADD_EVENT_NAME(OnPloughingEarthGround);
+	ADD_EVENT_NAME(OnSkillExpUpdate);
+	ADD_EVENT_NAME(OnPlayerChunkChanged);
+#undef ADD_EVENT_NAME
+}
+
+void UEventSystem::AddEventStats(const void* event, const TCHAR* name)
+{
+	FEventStats& stats = event_stats_.FindOrAdd(event);
+	stats.name_ = name;
+#if STATS
+	stats.stat_id_ = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_EventSystem>(stats.name_);
+#endif
+}
+
+const UEventSystem::FEventStats& UEventSystem::FindOrAddEventStats(const void* event)
+{
+	if (const FEventStats* stats = event_stats_.Find(event))return *stats;
+	AddEventStats(event, *FString::Printf(TEXT("Event_%p"), event));
+	return event_stats_[event];
+}
+
+void UEventSystem::RecordBroadcast(const void* event, double time)
+{
+	INC_DWORD_STAT(STAT_EventBroadcasts);
+	FEventStats* stats = event_stats_.Find(event);
+	if (stats == nullptr)return;
+	stats->broadcast_count_++;
+	stats->second_broadcast_count_++;
+	stats->total_time_ += time;
+	stats->max_time_ = FMath::Max(stats->max_time_, time);
+	stats->frame_time_ += time;
+}
+
+int32 UEventSystem::AddListenerStats(const UObject* object, FName event_name)
+{
+	FListenerStats stats;
+	stats.name_ = FString::Printf(TEXT("%s.%s"), *GetNameSafe(object), *event_name.ToString());
+	return listener_stats_.Add(MoveTemp(stats));
+}
+
+const FString& UEventSystem::GetListenerName(int32 listener) const
+{
+	static const FString kUnknownListener(TEXT("UnknownListener"));
+	return listener_stats_.IsValidIndex(listener) ? listener_stats_[listener].name_ : kUnknownListener;
+}
+
+void UEventSystem::RecordListener(int32 listener, double time)
+{
+	if (!listener_stats_.IsValidIndex(listener))return;
+	FListenerStats& stats = listener_stats_[listener];
+	stats.total_time_ += time;
+	stats.max_time_ = FMath::Max(stats.max_time_, time);
+	stats.frame_time_ += time;
+}
+
+void UEventSystem::UpdateFrameStats(float frame_time)
+{
+	SET_DWORD_STAT(STAT_EventBindings, bindings_.Num());
+	stats_second_time_ += frame_time;
+	if (stats_second_time_ >= 1.0f)
+	{
+		for (TPair<const void*, FEventStats>& stats : event_stats_)
+		{
+			stats.Value.broadcasts_per_second_ = stats.Value.second_broadcast_count_ / stats_second_time_;
+			stats.Value.second_broadcast_count_ = 0;
+		}
+		stats_second_time_ = 0.0f;
+	}
+
+	float budget = CVarEventHitchBudget.GetValueOnGameThread();
+	if (budget > 0.0f && frame_time * 1000.0f > budget)
+	{
+		TArray<const FEventStats*> events;
+		for (const TPair<const void*, FEventStats>& stats : event_stats_)
+		{
+			if (stats.Value.frame_time_ > 0.0)events.Add(&stats.Value);
+		}
+		events.Sort([](const FEventStats& a, const FEventStats& b) { return a.frame_time_ > b.frame_time_; });
+		TArray<const FListenerStats*> listeners;
+		for (const FListenerStats& stats : listener_stats_)
+		{
+			if (stats.frame_time_ > 0.0)listeners.Add(&stats);
+		}
+		listeners.Sort([](const FListenerStats& a, const FListenerStats& b) { return a.frame_time_ > b.frame_time_; });
+
+		UE_LOG(LogTemp, Warning, TEXT("EventSystem.cpp: UpdateFrameStats: Frame took %.2f ms, over the budget of %.2f ms"), frame_time * 1000.0f, budget);
+		for (int32 i = 0; i < events.Num() && i < kHitchReportCount; i++)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("    Event %s: %.3f ms"), *events[i]->name_, events[i]->frame_time_ * 1000.0);
+		}
+		for (int32 i = 0; i < listeners.Num() && i < kHitchReportCount; i++)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("    Listener %s: %.3f ms"), *listeners[i]->name_, listeners[i]->frame_time_ * 1000.0);
+		}
+	}
+
+	for (TPair<const void*, FEventStats>& stats : event_stats_)
+	{
+		stats.Value.frame_time_ = 0.0;
+	}
+	for (FListenerStats& stats : listener_stats_)
+	{
+		stats.frame_time_ = 0.0;
+	}
+}
 
+void UEventSystem::LogEventStats() const
+{
+	for (const TPair<const void*, FEventStats>& stats : event_stats_)
+	{
+		const FEventStats& event = stats.Value;
+		if (event.broadcast_count_ == 0)continue;
+		int32 live_count = 0;
+		int32 stale_count = 0;
+		GetBindingCounts(FName(*event.name_), live_count, stale_count);
+		UE_LOG(LogTemp, Log, TEXT("EventSystem.cpp: LogEventStats: %s: %d broadcasts, %.1f per second, %d listeners, %.3f ms in total, %.3f ms at most"),
+			*event.name_, event.broadcast_count_, event.broadcasts_per_second_, live_count, event.total_time_ * 1000.0, event.max_time_ * 1000.0);
+	}
+}
@@ -10,8 +10,14 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "EventQueue.h"
 #include "EventSystem.generated.h"
 
+DECLARE_STATS_GROUP(TEXT("EventSystem"), STATGROUP_EventSystem, STATCAT_Advanced);
+
 DECLARE_MULTICAST_DELEGATE(FMulticastDelegate);
 DECLARE_MULTICAST_DELEGATE_OneParam(FMulticastDelegateOneParam, int32);
 
@@ -21,11 +27,24 @@ DECLARE_MULTICAST_DELEGATE_ThreeParams(FMulticastDelegateThreeParams, int32, flo
 DECLARE_MULTICAST_DELEGATE_TwoParams(FMulticastDelegateTwoInt32Params, int32, int32);
 DECLARE_MULTICAST_DELEGATE_FourParams(FMulticastDelegateFourParams, int32, int32, float, float);
 
+/**
+ * The events that happen on a tile, they can be subscribed to by tile rectangle or chunk.
+ */
+enum class ETileEvent : uint8
+{
+	WaterCrop,
+	MowingGrassGround,
+	PloughingEarthGround,
+	PlacingItem,//The value is the item id
+	ToolsTowardsItemBlock//The value is the tool type
+};
+DECLARE_DELEGATE_FourParams(FTileEventDelegate, ETileEvent, int32, int32, int32);//Give it the event, the index(int32, int32) of the tile and the value(int32)
+
 /**
  * 
  */
 UCLASS()
-class STARDEWVALLEY_API UEventSystem : public UGameInstanceSubsystem
+class STARDEWVALLEY_API UEventSystem : public UGameInstanceSubsystem, public FTickableGameObject
 {
 	GENERATED_BODY()
 public:
@@ -44,12 +63,15 @@ public:
 	FMulticastDelegate OnHourChanged;
 	FMulticastDelegate OnDayChanged;
 	FMulticastDelegate OnSeasonChanged;
-	FMulticastDelegate OnMinuteChanged;
+	FMulticastDelegate OnMinuteChanged;//Once per frame in which the time flows, several minutes may have passed
 
 	FMulticastDelegate OnWeatherChanged;
 	FMulticastDelegate OnBaseTemperatureChanged;
 
-	FMulticastDelegate OnGroundGenerated;
+	FMulticastDelegate OnGroundGenerated;//The map is drawn and its items are registered, the character is spawned
+	FMulticastDelegate OnWorldReady;//The chunks around the character are loaded and the loading screen is gone
+	FMulticastDelegate OnGameSaving;//Write the state kept outside the data system into it, the game is about to be saved
+	FMulticastDelegate OnGameSaved;//The save is written to the disk
 	FMulticastDelegate OnGrassGroundMowed;
 	FMulticastDelegate OnEarthGroundPloughed;
 
@@ -78,4 +100,267 @@ public:
 	FMulticastDelegateTwoParams OnMowingGrassGround;//Give the position(float, float) of the grass to be mowed
 	FMulticastDelegateTwoParams OnPloughingEarthGround;//Give the position(float, float) of the earth to be ploughed
 	FMulticastDelegateTwoInt32Params OnSkillExpUpdate;//skill1->axe skill2->hoe skill3->scythe
+	FMulticastDelegateTwoInt32Params OnPlayerChunkChanged;//Give it the index(int32, int32) of the chunk the player entered
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return is_running_; };
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	//Deferred dispatch. The events below are queued and broadcast together once per frame, after the actors have ticked.
+	//If the dispatch is not deferred they are broadcast at once.
+	void PostMowingGrassGround(float x, float y);
+	void PostPloughingEarthGround(float x, float y);
+	void PostPlacingItem(int32 item_id, float x, float y);
+	void PostToolsTowardsItemBlock(int32 tool_type, float x, float y);
+	void PostItemBlockAttacked(int32 interaction_type, int32 damage, float x, float y);
+	void PostWaterCropAtGivenPosition(float x, float y);
+	/**
+	 * \brief Give items to the player. Items of the same id in a frame are given together.
+	 */
+	void PostGivenItems(int32 item_id, int32 amount);
+	/**
+	 * \brief Give exp to a skill. Exp of the same skill in a frame is given together.
+	 */
+	void PostSkillExpUpdate(int32 skill_type, int32 exp);
+	/**
+	 * \brief Broadcast the queued events. The input events go first, so the events they post are broadcast in the same dispatch.
+	 */
+	void DispatchQueuedEvents();
+	/**
+	 * \brief Set whether the events are queued. The queued events are dispatched when it is turned off.
+	 */
+	void set_is_dispatch_deferred(bool is_dispatch_deferred);
+	bool get_is_dispatch_deferred() const { return is_dispatch_deferred_; };
+
+	//Spatial routing. A tile event only reaches the subscribers whose rectangle covers the tile.
+	//The tile events are published by the Post* functions above, after the global broadcast.
+	/**
+	 * \brief Subscribe to an event on the tiles in the rectangle, the bounds are included.
+	 * \brief The rectangle is clipped to the map, so subscribe once the map is sized.
+	 *
+	 * \param type The event
+	 * \param x_begin The first index of the first tile
+	 * \param y_begin The second index of the first tile
+	 * \param x_end The first index of the last tile
+	 * \param y_end The second index of the last tile
+	 * \param callback The callback
+	 * \return An int32, the handle of the subscription, INDEX_NONE if the rectangle is empty on the map
+	 */
+	int32 SubscribeTileEvent(ETileEvent type, int32 x_begin, int32 y_begin, int32 x_end, int32 y_end, FTileEventDelegate callback);
+	/**
+	 * \brief Subscribe to an event on the tiles of the chunk.
+	 *
+	 * \return An int32, the handle of the subscription, INDEX_NONE if the rectangle is empty
+	 */
+	int32 SubscribeChunkEvent(ETileEvent type, int32 chunk_x, int32 chunk_y, FTileEventDelegate callback);
+	void UnsubscribeTileEvent(int32 subscription);
+	/**
+	 * \brief Remove every subscription whose callback is bound to the object, e.g. when an actor is destroyed.
+	 */
+	void UnsubscribeTileEvents(const UObject* object);
+	/**
+	 * \brief Call the subscribers of the event whose rectangle covers the tile, at once.
+	 *
+	 * \param type The event
+	 * \param x_index The first index of the tile
+	 * \param y_index The second index of the tile
+	 * \param value The value of the event, 0 if it has not
+	 */
+	void PublishTileEvent(ETileEvent type, int32 x_index, int32 y_index, int32 value = 0);
+	/**
+	 * \brief Call the subscribers of the event on the tile at the given position, at once.
+	 */
+	void PublishTileEventAtLocation(ETileEvent type, float x, float y, int32 value = 0);
+	int32 get_tile_subscription_count() const { return tile_subscriptions_.Num(); };
+
+	//Binding registry. The bindings are kept here, so they are removed from the events once their object is destroyed
+	//instead of piling up, e.g. for actors and widgets that come and go. They are timed for the instrumentation below.
+	/**
+	 * \brief Bind the method of the object to the event and keep the binding in the registry.
+	 *
+	 * \param event The event of the event system
+	 * \param event_name The name of the event, for the counts
+	 * \param object The object of the method
+	 * \param method The method
+	 * \return The handle of the binding
+	 */
+	template <typename DelegateType, typename UserClass, typename MethodType>
+	FDelegateHandle Subscribe(DelegateType& event, FName event_name, UserClass* object, MethodType method)
+	{
+		if (bindings_.Num() >= next_binding_sweep_)RemoveStaleBindings();
+		//The method is wrapped to be timed, the lambda is not called once the object is gone
+		int32 listener = AddListenerStats(object, event_name);
+		FDelegateHandle handle = event.AddWeakLambda(object, [this, object, method, listener](auto... args)
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*GetListenerName(listener));
+				double start_time = FPlatformTime::Seconds();
+				(object->*method)(args...);
+				RecordListener(listener, FPlatformTime::Seconds() - start_time);
+			});
+		FEventBinding binding;
+		binding.object_ = object;
+		binding.event_name_ = event_name;
+		binding.handle_ = handle;
+		binding.listener_ = listener;
+		binding.remove_ = [&event](FDelegateHandle binding_handle) { event.Remove(binding_handle); };
+		bindings_.Add(MoveTemp(binding));
+		return handle;
+	}
+	/**
+	 * \brief Remove every binding of the object in the registry.
+	 */
+	void UnsubscribeAll(const UObject* object);
+	/**
+	 * \brief Remove the bindings whose object has been destroyed. The events compact their invocation lists on removal.
+	 *
+	 * \return An int32, the number of bindings removed
+	 */
+	int32 RemoveStaleBindings();
+	/**
+	 * \brief Count the bindings of an event in the registry.
+	 *
+	 * \param event_name The name of the event
+	 * \param live_count The bindings whose object is alive
+	 * \param stale_count The bindings whose object has been destroyed but are not removed yet
+	 */
+	void GetBindingCounts(FName event_name, int32& live_count, int32& stale_count) const;
+	/**
+	 * \brief Log the live and stale bindings of every event in the registry.
+	 */
+	void LogBindingCounts() const;
+
+	//Instrumentation. The events broadcast through BroadcastEvent and the listeners bound through Subscribe are timed.
+	//Each event is a cycle stat of "stat EventSystem" and a trace scope in Unreal Insights. A frame longer than
+	//sv.EventHitchBudget milliseconds logs the events and listeners that took the most time in it.
+	/**
+	 * \brief Broadcast the event and record its stats. Use it instead of Broadcast for the events of the event system.
+	 *
+	 * \param event The event of the event system
+	 * \param args The parameters of the event
+	 */
+	template <typename DelegateType, typename... ArgTypes>
+	void BroadcastEvent(DelegateType& event, ArgTypes... args)
+	{
+		if (!event.IsBound())return;
+		const FEventStats& stats = FindOrAddEventStats(&event);
+		TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*stats.name_);
+		FScopeCycleCounter cycle_counter(stats.stat_id_);
+		double start_time = FPlatformTime::Seconds();
+		event.Broadcast(args...);
+		RecordBroadcast(&event, FPlatformTime::Seconds() - start_time);
+	}
+	/**
+	 * \brief Log the broadcasts per second, listeners, total and max time of every event.
+	 */
+	void LogEventStats() const;
+private:
+	/**
+	 * A binding of an object to an event, removed through the handle.
+	 */
+	struct FEventBinding
+	{
+		TWeakObjectPtr<const UObject> object_;
+		FName event_name_;
+		FDelegateHandle handle_;
+		int32 listener_;//The stats of the binding
+		TFunction<void(FDelegateHandle)> remove_;
+	};
+	TArray<FEventBinding> bindings_;
+	int32 next_binding_sweep_ = kMinBindingSweep;//Sweep the stale bindings when the registry grows to this size
+	FDelegateHandle post_garbage_collect_handle_;
+	static constexpr int32 kMinBindingSweep = 64;
+	/**
+	 * \brief The destroyed objects are gone after the garbage collection, sweep their bindings.
+	 */
+	void OnPostGarbageCollect();
+	/**
+	 * \brief Remove the binding from its event and drop its stats.
+	 */
+	void RemoveBinding(FEventBinding& binding);
+
+	struct FEventStats
+	{
+		FString name_;
+		TStatId stat_id_;
+		int32 broadcast_count_ = 0;
+		int32 second_broadcast_count_ = 0;//Broadcasts in the present second
+		float broadcasts_per_second_ = 0.0f;
+		double total_time_ = 0.0;//In seconds
+		double max_time_ = 0.0;
+		double frame_time_ = 0.0;
+	};
+	struct FListenerStats
+	{
+		FString name_;//Object.Event
+		double total_time_ = 0.0;//In seconds
+		double max_time_ = 0.0;
+		double frame_time_ = 0.0;
+	};
+	TMap<const void*, FEventStats> event_stats_;//Event -> stats
+	TSparseArray<FListenerStats> listener_stats_;
+	float stats_second_time_ = 0.0f;
+	static constexpr int32 kHitchReportCount = 5;
+	/**
+	 * \brief Name the events of the event system for their stats.
+	 */
+	void AddEventNames();
+	void AddEventStats(const void* event, const TCHAR* name);
+	const FEventStats& FindOrAddEventStats(const void* event);
+	void RecordBroadcast(const void* event, double time);
+	int32 AddListenerStats(const UObject* object, FName event_name);
+	const FString& GetListenerName(int32 listener) const;
+	void RecordListener(int32 listener, double time);
+	/**
+	 * \brief Update the broadcasts per second, log the events of the last frame if it was over the budget and start a new frame.
+	 *
+	 * \param frame_time The time of the last frame in seconds
+	 */
+	void UpdateFrameStats(float frame_time);
+	/**
+	 * A subscription to a tile event. It is kept in the bucket of every 16 x 16 tiles its rectangle overlaps.
+	 */
+	struct FTileSubscription
+	{
+		FTileEventDelegate callback_;
+		ETileEvent type_;
+		int32 x_begin_;
+		int32 y_begin_;
+		int32 x_end_;
+		int32 y_end_;
+	};
+	TSparseArray<FTileSubscription> tile_subscriptions_;//Indexed by the handle of the subscription
+	TMap<FIntPoint, TArray<int32>> tile_buckets_;//Bucket -> subscriptions
+	const int32 kTileBucketSize = 16;
+	/**
+	 * \brief Call the given function on each bucket the subscription overlaps.
+	 */
+	template <typename FuncType>
+	void ForEachBucketOf(const FTileSubscription& subscription, FuncType func) const;
+
+	//Broadcast the event and publish it to the subscribers of the tile
+	void BroadcastMowingGrassGround(float x, float y);
+	void BroadcastPloughingEarthGround(float x, float y);
+	void BroadcastPlacingItem(int32 item_id, float x, float y);
+	void BroadcastToolsTowardsItemBlock(int32 tool_type, float x, float y);
+	void BroadcastWaterCropAtGivenPosition(float x, float y);
+
+	TEventQueue<float, float> mowing_grass_ground_queue_;
+	TEventQueue<float, float> ploughing_earth_ground_queue_;
+	TEventQueue<int32, float, float> placing_item_queue_;
+	TEventQueue<int32, float, float> tools_towards_item_block_queue_;
+	TEventQueue<int32, int32, float, float> item_block_attacked_queue_;
+	TEventQueue<float, float> water_crop_queue_;
+	TEventQueue<int32, int32> given_items_queue_;
+	TEventQueue<int32, int32> skill_exp_queue_;
+	bool is_dispatch_deferred_ = true;
+	bool has_queued_events_ = false;
+	bool is_running_ = false;
+	const int32 kMaxDispatchRounds = 4;//Events posted by the handlers are dispatched again, up to this many times in a frame
 };
@@ -34,5 +34,8 @@ protected:
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
-
+	/**
+	 * \brief Get the mesh of the ground block. The ground renderer reads it from the blueprint default object.
+	 */
+	class UStaticMeshComponent* get_ground_mesh() const { return ground_mesh_; };
 };
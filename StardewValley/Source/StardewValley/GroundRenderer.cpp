@@ -0,0 +1,151 @@
+/*****************************************************************//**
+ * \file   GroundRenderer.cpp
+ * \brief  The implementation of the ground renderer
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "GroundRenderer.h"
+#include "GroundBlockBase.h"
+#include "Components/SceneComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+
+AGroundRenderer::AGroundRenderer()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	root_ = CreateDefaultSubobject<USceneComponent>(TEXT("root_"));
+	RootComponent = root_;
+	x_length_ = 0;
+	y_length_ = 0;
+	block_size_ = 0;
+}
+
+void AGroundRenderer::InitializeRenderer(const TArray<UClass*>& ground_classes, int32 x_length, int32 y_length, int32 block_size)
+{
+	x_length_ = x_length;
+	y_length_ = y_length;
+	block_size_ = block_size;
+	tile_type_index_.Init(INDEX_NONE, x_length * y_length);
+	tile_instance_index_.Init(INDEX_NONE, x_length * y_length);
+	instance_tiles_.SetNum(ground_classes.Num());
+	template_transforms_.Init(FTransform::Identity, ground_classes.Num());
+
+	for (int32 i = 0; i < ground_classes.Num(); i++)
+	{
+		if (ground_classes[i] == nullptr)//This type is not drawn
+		{
+			ground_meshes_.Add(nullptr);
+			continue;
+		}
+		UHierarchicalInstancedStaticMeshComponent* ground_mesh = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+		ground_mesh->SetupAttachment(RootComponent);
+
+		//The blueprint default object holds the mesh settings of this ground type
+		const AGroundBlockBase* ground_block = Cast<AGroundBlockBase>(ground_classes[i]->GetDefaultObject());
+		const UStaticMeshComponent* template_mesh = ground_block ? ground_block->get_ground_mesh() : nullptr;
+		if (template_mesh != nullptr)
+		{
+			ground_mesh->SetMobility(template_mesh->Mobility);
+			ground_mesh->SetStaticMesh(template_mesh->GetStaticMesh());
+			for (int32 j = 0; j < template_mesh->GetNumMaterials(); j++)
+			{
+				ground_mesh->SetMaterial(j, template_mesh->GetMaterial(j));
+			}
+			ground_mesh->SetCollisionProfileName(template_mesh->GetCollisionProfileName());
+			template_transforms_[i] = template_mesh->GetRelativeTransform();
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("GroundRenderer.cpp: InitializeRenderer: No ground mesh for type %d"), i);
+		}
+		ground_mesh->RegisterComponent();
+		AddInstanceComponent(ground_mesh);
+		ground_meshes_.Add(ground_mesh);
+	}
+}
+
+void AGroundRenderer::AddGroundInstance(int32 x_index, int32 y_index, int32 type_index)
+{
+	int32 index = TileIndex(x_index, y_index);
+	if (index == INDEX_NONE || !ground_meshes_.IsValidIndex(type_index) || ground_meshes_[type_index] == nullptr)return;
+	if (tile_type_index_[index] != INDEX_NONE)RemoveGroundInstance(x_index, y_index);
+
+	//Same transform as a ground actor spawned at this location
+	FTransform location(FVector(x_index * block_size_, y_index * block_size_, 0.0f));
+	int32 instance = ground_meshes_[type_index]->AddInstance(template_transforms_[type_index] * location);
+	tile_type_index_[index] = type_index;
+	tile_instance_index_[index] = instance;
+	instance_tiles_[type_index].Add(index);
+}
+
+void AGroundRenderer::RemoveGroundInstance(int32 x_index, int32 y_index)
+{
+	int32 index = TileIndex(x_index, y_index);
+	if (index == INDEX_NONE || tile_type_index_[index] == INDEX_NONE)return;
+
+	int32 type_index = tile_type_index_[index];
+	int32 instance = tile_instance_index_[index];
+	ground_meshes_[type_index]->RemoveInstance(instance);
+
+	//The hierarchical instanced mesh removes with a swap, the last instance takes the removed slot.
+	TArray<int32>& tiles = instance_tiles_[type_index];
+	int32 last_instance = tiles.Num() - 1;
+	if (instance != last_instance)
+	{
+		tiles[instance] = tiles[last_instance];
+		tile_instance_index_[tiles[instance]] = instance;
+	}
+	tiles.Pop(false);
+	tile_type_index_[index] = INDEX_NONE;
+	tile_instance_index_[index] = INDEX_NONE;
+}
+
+void AGroundRenderer::UpdateGroundInstance(int32 x_index, int32 y_index, int32 type_index)
+{
+	int32 index = TileIndex(x_index, y_index);
+	if (index == INDEX_NONE || tile_type_index_[index] == type_index)return;
+	AddGroundInstance(x_index, y_index, type_index);
+}
+
+bool AGroundRenderer::HasGroundInstance(int32 x_index, int32 y_index) const
+{
+	int32 index = TileIndex(x_index, y_index);
+	return index != INDEX_NONE && tile_type_index_[index] != INDEX_NONE;
+}
+
+int32 AGroundRenderer::get_instance_count() const
+{
+	int32 count = 0;
+	for (const TArray<int32>& tiles : instance_tiles_)
+	{
+		count += tiles.Num();
+	}
+	return count;
+}
+
+void AGroundRenderer::BeginBatchUpdate()
+{
+	for (UHierarchicalInstancedStaticMeshComponent* ground_mesh : ground_meshes_)
+	{
+		if (ground_mesh != nullptr)ground_mesh->bAutoRebuildTreeOnInstanceChanges = false;
+	}
+}
+
+void AGroundRenderer::EndBatchUpdate()
+{
+	for (UHierarchicalInstancedStaticMeshComponent* ground_mesh : ground_meshes_)
+	{
+		if (ground_mesh == nullptr)continue;
+		ground_mesh->bAutoRebuildTreeOnInstanceChanges = true;
+		ground_mesh->BuildTreeIfOutdated(true, false);//Only the meshes that have changed
+	}
+}
+
+int32 AGroundRenderer::TileIndex(int32 x_index, int32 y_index) const
+{
+	if (x_index < 0 || y_index < 0 || x_index >= x_length_ || y_index >= y_length_)return INDEX_NONE;
+	return x_index * y_length_ + y_index;
+}
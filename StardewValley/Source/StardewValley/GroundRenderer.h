@@ -0,0 +1,83 @@
+/*****************************************************************
+ * \file   GroundRenderer.h
+ * \brief  Draws the ground blocks. One hierarchical instanced mesh per ground type.
+ * \brief  The data system is still the source of truth, this actor only mirrors it.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GroundRenderer.generated.h"
+
+UCLASS()
+class STARDEWVALLEY_API AGroundRenderer : public AActor
+{
+	GENERATED_BODY()
+
+protected:
+	UPROPERTY(VisibleAnywhere)
+	class USceneComponent* root_;
+	UPROPERTY(VisibleAnywhere)
+	TArray<class UHierarchicalInstancedStaticMeshComponent*> ground_meshes_;
+private:
+	int32 x_length_;
+	int32 y_length_;
+	int32 block_size_;
+	TArray<FTransform> template_transforms_;//The transform of the mesh in each ground blueprint
+	TArray<int32> tile_type_index_;//Tile -> type index, INDEX_NONE if there is no ground
+	TArray<int32> tile_instance_index_;//Tile -> instance index in the mesh of its type
+	TArray<TArray<int32>> instance_tiles_;//Type -> instance index -> tile
+public:
+	// Sets default values for this actor's properties
+	AGroundRenderer();
+	/**
+	 * \brief Create one instanced mesh for each ground type.
+	 * \brief The mesh, materials, collision and transform are taken from the ground blueprint.
+	 *
+	 * \param ground_classes The ground blueprint classes, indexed by type index. A nullptr means the type is not drawn
+	 * \param x_length The number of blocks in x direction
+	 * \param y_length The number of blocks in y direction
+	 * \param block_size The size of a block
+	 */
+	void InitializeRenderer(const TArray<UClass*>& ground_classes, int32 x_length, int32 y_length, int32 block_size);
+	/**
+	 * \brief Add the ground instance of the given type at the given index.
+	 * \brief The instance will be removed first if there is already one.
+	 *
+	 * \param x_index The first index of the ground block
+	 * \param y_index The second index of the ground block
+	 * \param type_index The index of the ground type
+	 */
+	void AddGroundInstance(int32 x_index, int32 y_index, int32 type_index);
+	/**
+	 * \brief Remove the ground instance at the given index.
+	 *
+	 * \param x_index The first index of the ground block
+	 * \param y_index The second index of the ground block
+	 */
+	void RemoveGroundInstance(int32 x_index, int32 y_index);
+	/**
+	 * \brief Change the ground instance at the given index to the given type. Does nothing if the type is the same.
+	 *
+	 * \param x_index The first index of the ground block
+	 * \param y_index The second index of the ground block
+	 * \param type_index The index of the ground type
+	 */
+	void UpdateGroundInstance(int32 x_index, int32 y_index, int32 type_index);
+	/**
+	 * \brief Whether there is a ground instance at the given index.
+	 */
+	bool HasGroundInstance(int32 x_index, int32 y_index) const;
+	int32 get_instance_count() const;
+	/**
+	 * \brief Stop rebuilding the trees of the instanced meshes on every change, for many changes in a frame.
+	 * \brief EndBatchUpdate rebuilds the changed trees once, asynchronously.
+	 */
+	void BeginBatchUpdate();
+	void EndBatchUpdate();
+private:
+	int32 TileIndex(int32 x_index, int32 y_index) const;
+};
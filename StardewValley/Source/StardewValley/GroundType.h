@@ -0,0 +1,65 @@
+/*****************************************************************
+ * \file   GroundType.h
+ * \brief  The types of ground blocks. Stored as one byte per block.
+ * \brief  The names are only used at the Blueprint/UI edge and for old saves.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GroundType.generated.h"
+
+UENUM(BlueprintType)
+enum class EGroundType : uint8
+{
+	None,
+	Grass,
+	Earth,
+	Field,
+	Snow,
+	Water,
+	Count UMETA(Hidden)
+};
+
+/**
+ * \brief Get the name of the ground type, e.g. "GrassGround".
+ *
+ * \param type The ground type
+ * \return An FString, empty for EGroundType::None
+ */
+inline FString GroundTypeToString(EGroundType type)
+{
+	switch (type)
+	{
+	case EGroundType::Grass:
+		return TEXT("GrassGround");
+	case EGroundType::Earth:
+		return TEXT("EarthGround");
+	case EGroundType::Field:
+		return TEXT("FieldGround");
+	case EGroundType::Snow:
+		return TEXT("SnowGround");
+	case EGroundType::Water:
+		return TEXT("WaterGround");
+	default:
+		return TEXT("");
+	}
+}
+
+/**
+ * \brief Get the ground type of the name, e.g. "GrassGround".
+ *
+ * \param type The name of the ground type
+ * \return An EGroundType, EGroundType::None if the name is unknown
+ */
+inline EGroundType StringToGroundType(const FString& type)
+{
+	if (type == TEXT("GrassGround"))return EGroundType::Grass;
+	else if (type == TEXT("EarthGround"))return EGroundType::Earth;
+	else if (type == TEXT("FieldGround"))return EGroundType::Field;
+	else if (type == TEXT("SnowGround"))return EGroundType::Snow;
+	else if (type == TEXT("WaterGround"))return EGroundType::Water;
+	return EGroundType::None;
+}
@@ -29,34 +29,11 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-protected:
-	int32 lived_time_;
-	bool is_today_watered_;
-	/**
-	 * Grows the crop to the next stage.
-	 *
-	 */
-	virtual void Grow();
-	/**
-	 * \brief Sets is_today_watered_ to false.
-	 * 
-	 */
-	virtual void GetThirsty();
+public:
 	/**
 	 * Sets the appearance of the item block.
 	 * 
 	 * \param status The status of the item block
 	 */
 	virtual void SetAppearanceByStatus(int32 status);
-public:
-	/**
-	 * \brief Water the crop.
-	 *
-	 */
-	virtual void WaterThisCrop();
-	/**
-	 * To have rain waters this crop.
-	 *
-	 */
-	virtual void RainWatersThisCrop();
-};
+};
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*****************************************************************//**
+ * \file   ItemRegistry.cpp
+ * \brief  The implementation of the item registry
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "ItemRegistry.h"
+#include "Engine/DataTable.h"
+#include "Struct_ItemBlockBase.h"
+#include "Struct_ItemBase.h"
+#include "Algo/BinarySearch.h"
+
+int32 FItemDefinition::GetStatusOfLivedTime(int32 lived_time) const
+{
+	int32 stage = Algo::LowerBound(stage_end_time_, lived_time);
+	return stage_status_.IsValidIndex(stage) ? stage_status_[stage] : 0;
+}
+
+int32 FItemDefinition::GetStatusReachedAt(int32 lived_time) const
+{
+	int32 stage = Algo::UpperBound(stage_end_time_, lived_time) - 1;
+	return stage_status_.IsValidIndex(stage) ? stage_status_[stage] + 1 : 0;
+}
+
+int32 FItemDefinition::GetNextChangeTime(int32 lived_time) const
+{
+	int32 stage = Algo::UpperBound(stage_end_time_, lived_time);
+	if (stage_end_time_.IsValidIndex(stage))return FMath::Min(stage_end_time_[stage], total_lifespan_);
+	return total_lifespan_;
+}
+
+FVector FItemDefinition::GetScaleOfStatus(int32 status) const
+{
+	if (stage_scale_.IsValidIndex(status - 1))return stage_scale_[status - 1];
+	FVector scale(scale_, scale_, scale_);
+	for (int32 i = 1; i < status; i++)
+	{
+		scale *= kGrowthRate;
+	}
+	return scale;
+}
+
+void UItemRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	item_block_table_ = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBlockBase.DT_ItemBlockBase"));
+	item_table_ = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBase.DT_ItemBase"));
+
+	if (item_block_table_ != nullptr)
+	{
+		for (const TPair<FName, uint8*>& row : item_block_table_->GetRowMap())
+		{
+			int32 id = RowNameToId(row.Key);
+			if (id == -1)continue;
+			BuildBlockDefinition(FindOrAddDefinition(id), *reinterpret_cast<const FStruct_ItemBlockBase*>(row.Value));
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("ItemRegistry.cpp: Initialize: Failed to load DT_ItemBlockBase"));
+	}
+	if (item_table_ != nullptr)
+	{
+		for (const TPair<FName, uint8*>& row : item_table_->GetRowMap())
+		{
+			int32 id = RowNameToId(row.Key);
+			if (id == -1)continue;
+			FItemDefinition& definition = FindOrAddDefinition(id);
+			definition.item_info_ = reinterpret_cast<const FStruct_ItemBase*>(row.Value);
+			definition.icon_ = definition.item_info_->icon_;
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("ItemRegistry.cpp: Initialize: Failed to load DT_ItemBase"));
+	}
+}
+
+void UItemRegistry::Deinitialize()
+{
+	Super::Deinitialize();
+
+	definitions_.Empty();
+	item_block_table_ = nullptr;
+	item_table_ = nullptr;
+}
+
+int32 UItemRegistry::RowNameToId(const FName& row_name)
+{
+	FString name = row_name.ToString();
+	if (!name.IsNumeric())return -1;
+	return FCString::Atoi(*name);
+}
+
+FItemDefinition& UItemRegistry::FindOrAddDefinition(int32 id)
+{
+	check(id >= 0);
+	if (id > kMaxItemId)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ItemRegistry.cpp: FindOrAddDefinition: Item id %d is very large"), id);
+	}
+	if (definitions_.Num() <= id)definitions_.SetNum(id + 1);
+	definitions_[id].id_ = id;
+	return definitions_[id];
+}
+
+void UItemRegistry::BuildBlockDefinition(FItemDefinition& definition, const FStruct_ItemBlockBase& block_info)
+{
+	definition.block_info_ = &block_info;
+	definition.type_ = block_info.type_;
+	definition.scale_ = block_info.scale_;
+	definition.durability_ = block_info.durability_;
+	definition.mesh_ = block_info.mesh_;
+	definition.material_ = block_info.material_;
+	definition.interaction_accepted_ = block_info.interaction_accepted_;
+	for (const TPair<int32, int32>& drop : block_info.map_item_drop_)
+	{
+		definition.item_drop_.Add(drop);
+	}
+
+	//The statuses of a crop are 1, 2, 3... and each lasts map_lifespan_[status] hours
+	int32 status_count = block_info.map_lifespan_.Num();
+	int32 accumulated_time = 0;
+	for (int32 i = 1; i <= status_count; i++)
+	{
+		if (const int32* lifespan = block_info.map_lifespan_.Find(i))
+		{
+			accumulated_time += *lifespan * 60;
+			definition.stage_end_time_.Add(accumulated_time);
+			definition.stage_status_.Add(i);
+		}
+	}
+	definition.total_lifespan_ = 0;
+	for (const TPair<int32, int32>& lifespan : block_info.map_lifespan_)
+	{
+		definition.total_lifespan_ += lifespan.Value * 60;
+	}
+	//A crop reaches status_count + 1 at the end of its last status
+	definition.stage_scale_.SetNum(status_count + 1);
+	FVector scale(definition.scale_, definition.scale_, definition.scale_);
+	for (int32 i = 0; i <= status_count; i++)
+	{
+		definition.stage_scale_[i] = scale;
+		scale *= FItemDefinition::kGrowthRate;
+	}
+}
@@ -0,0 +1,127 @@
+/*****************************************************************
+ * \file   ItemRegistry.h
+ * \brief  The definitions of all items. DT_ItemBlockBase and DT_ItemBase are loaded once
+ * \brief  and flattened into an array indexed by item id, so a lookup is an array read.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "ItemRegistry.generated.h"
+
+struct FStruct_ItemBlockBase;
+struct FStruct_ItemBase;
+class UStaticMesh;
+class UMaterialInterface;
+class UTexture2D;
+
+/**
+ * The definition of one item id. The rows stay owned by the data tables.
+ */
+struct FItemDefinition
+{
+	int32 id_ = -1;
+	const FStruct_ItemBlockBase* block_info_ = nullptr;//Row of DT_ItemBlockBase, nullptr if the id can not be placed
+	const FStruct_ItemBase* item_info_ = nullptr;//Row of DT_ItemBase, nullptr if the id can not be in the bag
+	//Copied from the row
+	int32 type_ = -1;//0 invisible wall, 1 crop, 2 architecture, 3 destroyable, 4 fire
+	float scale_ = 1.0f;
+	int32 durability_ = -1;
+	UStaticMesh* mesh_ = nullptr;
+	UMaterialInterface* material_ = nullptr;
+	UTexture2D* icon_ = nullptr;
+	TArray<int32> interaction_accepted_;
+	TArray<TPair<int32, int32>> item_drop_;//Item id, amount
+	//Derived from the row
+	//The growth table of a crop, sorted by time. Status stage_status_[k] ends when the lived time reaches stage_end_time_[k].
+	TArray<int32> stage_end_time_;//Prefix sums of the lifespans of the statuses, in minutes
+	TArray<int32> stage_status_;
+	TArray<FVector> stage_scale_;//Scale of status i is stage_scale_[i - 1]
+	int32 total_lifespan_ = 0;//In minutes, the crop is gone when its lived time reaches it
+	static constexpr float kGrowthRate = 1.25f;//The crop grows by this scale at each status
+
+	bool is_block() const { return block_info_ != nullptr; };
+	bool is_crop() const { return type_ == 1; };
+	bool is_fire() const { return type_ == 4; };
+	bool is_interaction_accepted(int32 interaction_type) const { return interaction_accepted_.Contains(interaction_type); };
+	/**
+	 * \brief Get the status of a crop that has lived the given time.
+	 *
+	 * \param lived_time The lived time in minutes
+	 * \return An int32, the first status that has not ended. 0 if every status has ended
+	 */
+	int32 GetStatusOfLivedTime(int32 lived_time) const;
+	/**
+	 * \brief Get the status a crop has grown into by the given lived time, the one after the last status that has ended.
+	 *
+	 * \param lived_time The lived time in minutes
+	 * \return An int32, 0 if no status has ended
+	 */
+	int32 GetStatusReachedAt(int32 lived_time) const;
+	/**
+	 * \brief Get the time of the next status change or death after the given lived time.
+	 *
+	 * \param lived_time The lived time in minutes
+	 * \return An int32, the lived time of the next change
+	 */
+	int32 GetNextChangeTime(int32 lived_time) const;
+	/**
+	 * \brief Get the scale of the crop at the given status.
+	 *
+	 * \param status The status, starts from 1
+	 * \return An FVector, the scale of the mesh
+	 */
+	FVector GetScaleOfStatus(int32 status) const;
+};
+
+/**
+ *
+ */
+UCLASS()
+class STARDEWVALLEY_API UItemRegistry : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+	/**
+	 * \brief Get the definition of the item.
+	 *
+	 * \param id The id of the item
+	 * \return The definition, nullptr if the id is in neither table
+	 */
+	const FItemDefinition* GetItemDefinition(int32 id) const { return definitions_.IsValidIndex(id) && definitions_[id].id_ != -1 ? &definitions_[id] : nullptr; };
+	/**
+	 * \brief Get the row of DT_ItemBlockBase of the item.
+	 *
+	 * \param id The id of the item
+	 * \return The row, nullptr if there is not
+	 */
+	const FStruct_ItemBlockBase* GetItemBlockInfo(int32 id) const { const FItemDefinition* definition = GetItemDefinition(id); return definition ? definition->block_info_ : nullptr; };
+	/**
+	 * \brief Get the row of DT_ItemBase of the item.
+	 *
+	 * \param id The id of the item
+	 * \return The row, nullptr if there is not
+	 */
+	const FStruct_ItemBase* GetItemInfo(int32 id) const { const FItemDefinition* definition = GetItemDefinition(id); return definition ? definition->item_info_ : nullptr; };
+private:
+	/**
+	 * \brief Get the id of a row. The rows are named by their ids.
+	 *
+	 * \return An int32, -1 if the name is not an id
+	 */
+	static int32 RowNameToId(const FName& row_name);
+	FItemDefinition& FindOrAddDefinition(int32 id);
+	void BuildBlockDefinition(FItemDefinition& definition, const FStruct_ItemBlockBase& block_info);
+
+	UPROPERTY()
+	class UDataTable* item_block_table_;//Keeps the rows and their assets loaded
+	UPROPERTY()
+	class UDataTable* item_table_;
+	TArray<FItemDefinition> definitions_;//Indexed by item id
+	const int32 kMaxItemId = 4095;
+};
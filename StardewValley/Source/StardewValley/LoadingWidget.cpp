@@ -0,0 +1,53 @@
+/*****************************************************************//**
+ * \file   LoadingWidget.cpp
+ * \brief  The implementation of the loading widget
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "LoadingWidget.h"
+#include "Blueprint/WidgetTree.h"
+#include "Components/Border.h"
+#include "Components/ProgressBar.h"
+#include "Components/SizeBox.h"
+#include "Components/TextBlock.h"
+#include "Components/VerticalBox.h"
+#include "Components/VerticalBoxSlot.h"
+
+void ULoadingWidget::SetProgress(float progress, const FText& stage)
+{
+	if (progress_bar_ != nullptr)progress_bar_->SetPercent(FMath::Clamp(progress, 0.0f, 1.0f));
+	if (stage_text_ != nullptr)stage_text_->SetText(stage);
+}
+
+TSharedRef<SWidget> ULoadingWidget::RebuildWidget()
+{
+	if (WidgetTree != nullptr && WidgetTree->RootWidget == nullptr)
+	{
+		//A dark screen with the stage above a progress bar in the middle
+		UBorder* Background = WidgetTree->ConstructWidget<UBorder>(UBorder::StaticClass(), TEXT("Background"));
+		Background->SetBrushColor(FLinearColor(0.02f, 0.02f, 0.02f, 1.0f));
+		Background->SetHorizontalAlignment(HAlign_Center);
+		Background->SetVerticalAlignment(VAlign_Center);
+		WidgetTree->RootWidget = Background;
+
+		UVerticalBox* Box = WidgetTree->ConstructWidget<UVerticalBox>(UVerticalBox::StaticClass(), TEXT("Box"));
+		Background->SetContent(Box);
+
+		UTextBlock* StageText = WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), TEXT("StageText"));
+		StageText->SetColorAndOpacity(FSlateColor(FLinearColor::White));
+		UVerticalBoxSlot* TextSlot = Box->AddChildToVerticalBox(StageText);
+		TextSlot->SetHorizontalAlignment(HAlign_Center);
+		TextSlot->SetPadding(FMargin(0.0f, 0.0f, 0.0f, 8.0f));
+
+		USizeBox* BarBox = WidgetTree->ConstructWidget<USizeBox>(USizeBox::StaticClass(), TEXT("BarBox"));
+		BarBox->SetWidthOverride(kProgressBarWidth);
+		Box->AddChildToVerticalBox(BarBox);
+		UProgressBar* ProgressBar = WidgetTree->ConstructWidget<UProgressBar>(UProgressBar::StaticClass(), TEXT("ProgressBar"));
+		BarBox->SetContent(ProgressBar);
+	}
+	stage_text_ = Cast<UTextBlock>(GetWidgetFromName(TEXT("StageText")));
+	progress_bar_ = Cast<UProgressBar>(GetWidgetFromName(TEXT("ProgressBar")));
+	return Super::RebuildWidget();
+}
@@ -0,0 +1,39 @@
+/*********************************************************************
+ * \file   LoadingWidget.h
+ * \brief  The loading screen shown while the world is being built. It shows the stage and the progress.
+ * \brief  The widgets are built in code. A blueprint child may lay them out itself, named StageText and ProgressBar.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "LoadingWidget.generated.h"
+
+/**
+ *
+ */
+UCLASS()
+class STARDEWVALLEY_API ULoadingWidget : public UUserWidget
+{
+	GENERATED_BODY()
+public:
+	/**
+	 * \brief Show the progress of the loading.
+	 *
+	 * \param progress The progress, from 0 to 1
+	 * \param stage What is being loaded
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetProgress(float progress, const FText& stage);
+protected:
+	TSharedRef<SWidget> RebuildWidget() override;
+private:
+	UPROPERTY()
+	class UTextBlock* stage_text_;
+	UPROPERTY()
+	class UProgressBar* progress_bar_;
+	const float kProgressBarWidth = 480.0f;
+};
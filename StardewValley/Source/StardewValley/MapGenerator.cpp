@@ -0,0 +1,139 @@
+/*****************************************************************//**
+ * \file   MapGenerator.cpp
+ * \brief  The implementation of the map generator
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "MapGenerator.h"
+
+DECLARE_CYCLE_STAT(TEXT("Generate map"), STAT_GenerateMap, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Apply generated map"), STAT_ApplyGeneratedMap, STATGROUP_Game);
+
+constexpr int32 FMapGenerator::kRockIds[];
+
+void FMapGenerator::Generate(const FMapGenerationSettings& settings, FGeneratedMap& map)
+{
+	SCOPE_CYCLE_COUNTER(STAT_GenerateMap);
+
+	const int32 x_length = FMath::Max(settings.x_length_, 1);
+	const int32 y_length = FMath::Max(settings.y_length_, 1);
+	map.seed_ = settings.seed_;
+	map.x_length_ = x_length;
+	map.y_length_ = y_length;
+	map.ground_type_.Init(EGroundType::Grass, x_length * y_length);
+	map.item_id_.Init(-1, x_length * y_length);
+
+	//Each layer of noise is sampled at its own offset of the seed
+	FRandomStream stream(settings.seed_);
+	auto RandomOffset = [&stream]() { return FVector2D(stream.FRandRange(-kNoiseOffsetRange, kNoiseOffsetRange), stream.FRandRange(-kNoiseOffsetRange, kNoiseOffsetRange)); };
+	const FVector2D elevation_offset = RandomOffset();
+	const FVector2D moisture_offset = RandomOffset();
+	const FVector2D forest_offset = RandomOffset();
+	const FVector2D rock_offset = RandomOffset();
+
+	//The farm is on the right of the spawn, the spawn and the farm are kept clear
+	const FIntPoint spawn = settings.spawn_tile_;
+	const int32 farm_x_begin = spawn.X + 2;
+	const int32 farm_x_end = farm_x_begin + settings.farm_size_.X - 1;
+	const int32 farm_y_begin = spawn.Y - settings.farm_size_.Y / 2;
+	const int32 farm_y_end = farm_y_begin + settings.farm_size_.Y - 1;
+	const int32 clear_radius = settings.spawn_clear_radius_;
+
+	for (int32 x = 0, index = 0; x < x_length; x++)
+		for (int32 y = 0; y < y_length; y++, index++)
+		{
+			EGroundType& type = map.ground_type_[index];
+			int32& id = map.item_id_[index];
+			const FVector2D location(static_cast<float>(x), static_cast<float>(y));
+			const bool is_in_farm = x >= farm_x_begin && x <= farm_x_end && y >= farm_y_begin && y <= farm_y_end;
+			const bool is_clear = is_in_farm || (FMath::Abs(x - spawn.X) <= clear_radius && FMath::Abs(y - spawn.Y) <= clear_radius)
+				|| (x >= farm_x_begin - clear_radius && x <= farm_x_end + clear_radius && y >= farm_y_begin - clear_radius && y <= farm_y_end + clear_radius);
+
+			//Ground
+			if (is_in_farm)
+			{
+				bool is_farm_border = x == farm_x_begin || x == farm_x_end || y == farm_y_begin || y == farm_y_end;
+				type = is_farm_border ? EGroundType::Earth : EGroundType::Field;
+			}
+			else if (!is_clear && FractalNoise(location * kZoneScale + elevation_offset, kNoiseOctaves) < settings.water_level_)
+			{
+				type = EGroundType::Water;
+			}
+			else if (FractalNoise(location * kZoneScale + moisture_offset, kNoiseOctaves) < settings.dry_level_)
+			{
+				type = EGroundType::Earth;
+			}
+
+			//Items
+			if (x == 0 || y == 0 || x == x_length - 1 || y == y_length - 1)
+			{
+				id = kWallId;
+				continue;
+			}
+			if (is_clear || type == EGroundType::Water)continue;
+			const float roll = HashToUnit(HashTile(settings.seed_, x, y, 0));
+			const uint32 pick = HashTile(settings.seed_, x, y, 1);
+			if (FractalNoise(location * kScatterScale + forest_offset, kNoiseOctaves) > settings.forest_level_)
+			{
+				if (roll < settings.forest_density_)id = kTreeId;
+			}
+			else if (FractalNoise(location * kScatterScale + rock_offset, kNoiseOctaves) > settings.rock_level_)
+			{
+				if (roll < settings.rock_density_)id = kRockIds[pick % UE_ARRAY_COUNT(kRockIds)];
+			}
+			else if (roll < settings.scatter_density_)
+			{
+				//Mostly trees, as many of each rock as the old layout had
+				id = pick % 14 < 10 ? kTreeId : kRockIds[pick % UE_ARRAY_COUNT(kRockIds)];
+			}
+		}
+}
+
+FGraphEventRef FMapGenerator::GenerateAsync(const FMapGenerationSettings& settings, TFunction<void(FGeneratedMap&)> on_generated)
+{
+	//The map is only touched by one task at a time, the apply task waits for the generate task
+	TSharedRef<FGeneratedMap, ESPMode::ThreadSafe> map = MakeShared<FGeneratedMap, ESPMode::ThreadSafe>();
+	FGraphEventRef generated = FFunctionGraphTask::CreateAndDispatchWhenReady([settings, map]()
+		{
+			Generate(settings, map.Get());
+		}, GET_STATID(STAT_GenerateMap), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask);
+
+	FGraphEventArray prerequisites;
+	prerequisites.Add(generated);
+	return FFunctionGraphTask::CreateAndDispatchWhenReady([map, on_generated = MoveTemp(on_generated)]()
+		{
+			on_generated(map.Get());
+		}, GET_STATID(STAT_ApplyGeneratedMap), &prerequisites, ENamedThreads::GameThread);
+}
+
+float FMapGenerator::FractalNoise(const FVector2D& location, int32 octaves)
+{
+	float noise = 0.0f;
+	float amplitude = 1.0f;
+	float frequency = 1.0f;
+	float total_amplitude = 0.0f;
+	for (int32 i = 0; i < octaves; i++)
+	{
+		noise += FMath::PerlinNoise2D(location * frequency) * amplitude;
+		total_amplitude += amplitude;
+		amplitude *= 0.5f;
+		frequency *= 2.0f;
+	}
+	return noise / total_amplitude;
+}
+
+uint32 FMapGenerator::HashTile(int32 seed, int32 x, int32 y, uint32 salt)
+{
+	uint32 hash = static_cast<uint32>(seed) * 0x9E3779B1u;
+	hash ^= static_cast<uint32>(x) * 0x85EBCA77u;
+	hash ^= static_cast<uint32>(y) * 0xC2B2AE3Du;
+	hash ^= salt * 0x27D4EB2Fu;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6Du;
+	hash ^= hash >> 12;
+	hash *= 0x297A2D39u;
+	hash ^= hash >> 15;
+	return hash;
+}
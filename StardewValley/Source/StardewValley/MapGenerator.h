@@ -0,0 +1,87 @@
+/*****************************************************************
+ * \file   MapGenerator.h
+ * \brief  Generates a new map from a seed. The ground is split into zones by noise: water, grass and dry earth,
+ * \brief  with a farm field next to the spawn of the player. Trees and rocks are scattered in forests and rock fields.
+ * \brief  The same seed and size always give the same map. The generation runs on a worker thread of the task graph.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "GroundType.h"
+
+/**
+ * The parameters of a new map. The levels are compared with noise in about [-1, 1].
+ */
+struct FMapGenerationSettings
+{
+	int32 seed_ = 0;
+	int32 x_length_ = 128;
+	int32 y_length_ = 128;
+	FIntPoint spawn_tile_ = FIntPoint(5, 27);//Where the player spawns, kept clear of water and items
+	int32 spawn_clear_radius_ = 6;
+	FIntPoint farm_size_ = FIntPoint(24, 16);//The field next to the spawn, including its earth border
+	float water_level_ = -0.28f;//Lower ground is water
+	float dry_level_ = -0.3f;//Drier ground is earth
+	float forest_level_ = 0.18f;
+	float forest_density_ = 0.55f;//The chance of a tree on a block of a forest
+	float rock_level_ = 0.3f;
+	float rock_density_ = 0.35f;//The chance of a rock on a block of a rock field
+	float scatter_density_ = 0.02f;//The chance of a tree or rock anywhere else
+};
+
+/**
+ * The blocks of a generated map, index = x * y_length + y like FTileStore.
+ */
+struct FGeneratedMap
+{
+	int32 seed_ = 0;
+	int32 x_length_ = 0;
+	int32 y_length_ = 0;
+	TArray<EGroundType> ground_type_;
+	TArray<int32> item_id_;//-1 if there is no item
+};
+
+class STARDEWVALLEY_API FMapGenerator
+{
+public:
+	/**
+	 * \brief Generate the map on the calling thread. Touches no UObject, so it can run on any thread.
+	 *
+	 * \param settings The seed and the parameters of the map
+	 * \param map Return value. The ground type and item id of each block
+	 */
+	static void Generate(const FMapGenerationSettings& settings, FGeneratedMap& map);
+	/**
+	 * \brief Generate the map on a worker thread, then hand it to the callback on the game thread.
+	 *
+	 * \param settings The seed and the parameters of the map
+	 * \param on_generated Called on the game thread with the generated map
+	 * \return A FGraphEventRef, completed after the callback
+	 */
+	static FGraphEventRef GenerateAsync(const FMapGenerationSettings& settings, TFunction<void(FGeneratedMap&)> on_generated);
+private:
+	/**
+	 * \brief Perlin noise summed over octaves, each of double frequency and half amplitude. In about [-1, 1].
+	 */
+	static float FractalNoise(const FVector2D& location, int32 octaves);
+	/**
+	 * \brief A random number of the block, the same for the same seed, block and salt whatever order the blocks are visited in.
+	 */
+	static uint32 HashTile(int32 seed, int32 x, int32 y, uint32 salt);
+	/**
+	 * \brief Map a hash to [0, 1).
+	 */
+	static float HashToUnit(uint32 hash) { return static_cast<float>(hash >> 8) / 16777216.0f; };
+
+	static constexpr int32 kWallId = 4;//Invisible wall around the map
+	static constexpr int32 kTreeId = 6;
+	static constexpr int32 kRockIds[] = { 5, 12, 13, 14 };
+	static constexpr int32 kNoiseOctaves = 4;
+	static constexpr float kZoneScale = 1.0f / 48.0f;//Noise per block, zones are a few dozen blocks wide
+	static constexpr float kScatterScale = 1.0f / 24.0f;
+	static constexpr float kNoiseOffsetRange = 4096.0f;//Each seed samples the noise at another offset
+};
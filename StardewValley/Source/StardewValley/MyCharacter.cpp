@@ -61,9 +61,14 @@ void AMyCharacter::BeginPlay()
 		PlayerController->SetInputMode(FInputModeGameAndUI().SetLockMouseToViewportBehavior(EMouseLockMode::DoNotLock));
 	}
 
-	//GetGameInstance()->GetSubsystem<UEventSystem>()->OnWoodAxed.AddUObject(this, &AMyCharacter::Skill1ExpUpdate);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnEarthGroundPloughed.AddUObject(this, &AMyCharacter::Skill2ExpUpdate);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnGrassGroundMowed.AddUObject(this, &AMyCharacter::Skill3ExpUpdate);
+	//The bindings are removed by the event system once the character is destroyed
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	//EventSystem->Subscribe(EventSystem->OnWoodAxed, TEXT("OnWoodAxed"), this, &AMyCharacter::Skill1ExpUpdate);
+	EventSystem->Subscribe(EventSystem->OnEarthGroundPloughed, TEXT("OnEarthGroundPloughed"), this, &AMyCharacter::Skill2ExpUpdate);
+	EventSystem->Subscribe(EventSystem->OnGrassGroundMowed, TEXT("OnGrassGroundMowed"), this, &AMyCharacter::Skill3ExpUpdate);
+
+	//Load the map around the character
+	ChunkLocationUpdate();
 }
 
 // Called every frame
@@ -71,6 +76,7 @@ void AMyCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	ChunkLocationUpdate();
 }
 
 // Called to bind functionality to input
@@ -126,52 +132,62 @@ void AMyCharacter::MoveUp(float Value)
 void AMyCharacter::CharacterSelectShortcut1() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut1"));
 	now_shortcut_ = 1;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut2() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut2"));
 	now_shortcut_ = 2;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut3() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut3"));
 	now_shortcut_ = 3;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut4() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut4"));
 	now_shortcut_ = 4;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut5() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut5"));
 	now_shortcut_ = 5;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut6() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut6"));
 	now_shortcut_ = 6;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut7() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut7"));
 	now_shortcut_ = 7;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut8() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut8"));
 	now_shortcut_ = 8;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut9() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut9"));
 	now_shortcut_ = 9;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 void AMyCharacter::CharacterSelectShortcut10() {
 	UE_LOG(LogTemp, Warning, TEXT("Select Shortcut10"));
 	now_shortcut_ = 10;
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnShortcutSelected.Broadcast(now_shortcut_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnShortcutSelected, now_shortcut_);
 }
 
 void AMyCharacter::MouseClick() {
@@ -210,13 +226,13 @@ void AMyCharacter::CharacterToolsUse(FVector Location) {
 	UE_LOG(LogTemp, Warning, TEXT("Distance: %f"), distance);
 	if (permit_range - distance > KINDA_SMALL_NUMBER) {
 		//if (now_item_id == 1)//item is tool->scythe
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnMowingGrassGround.Broadcast(Location.X, Location.Y);
+			GetGameInstance()->GetSubsystem<UEventSystem>()->PostMowingGrassGround(Location.X, Location.Y);
 		//if (now_item_id == 2)//tool is tool->hoe
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnPloughingEarthGround.Broadcast(Location.X, Location.Y);
+			GetGameInstance()->GetSubsystem<UEventSystem>()->PostPloughingEarthGround(Location.X, Location.Y);
 		//if (now_item_id > 10)//item is an real deployable item
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnPlacingItem.Broadcast(now_item_id, Location.X, Location.Y);
+			GetGameInstance()->GetSubsystem<UEventSystem>()->PostPlacingItem(now_item_id, Location.X, Location.Y);
 		//else//item is other tools
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnToolsTowardsItemBlock.Broadcast(now_item_id, Location.X, Location.Y);
+			GetGameInstance()->GetSubsystem<UEventSystem>()->PostToolsTowardsItemBlock(now_item_id, Location.X, Location.Y);
 	}
 }
 
@@ -260,15 +276,15 @@ void AMyCharacter::UseSkill3() {
 }
 
 void AMyCharacter::Skill1ExpUpdate(){
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnSkillExpUpdate.Broadcast(1, 20);
+	GetGameInstance()->GetSubsystem<UEventSystem>()->PostSkillExpUpdate(1, 20);
 }
 
 void AMyCharacter::Skill2ExpUpdate() {
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnSkillExpUpdate.Broadcast(2, 20);
+	GetGameInstance()->GetSubsystem<UEventSystem>()->PostSkillExpUpdate(2, 20);
 }
 
 void AMyCharacter::Skill3ExpUpdate() {
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnSkillExpUpdate.Broadcast(3, 20);
+	GetGameInstance()->GetSubsystem<UEventSystem>()->PostSkillExpUpdate(3, 20);
 }
 
 void AMyCharacter::AxeEndCoolDown() {
@@ -292,9 +308,24 @@ void AMyCharacter::ScytheEndCoolDown() {
 void AMyCharacter::CallMenu() {
 	UE_LOG(LogTemp, Warning, TEXT("Call Menu"));
 	CharacterLocationUpdate();
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnCallingMenu.Broadcast();
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnCallingMenu);
 }
 
 void AMyCharacter::CharacterLocationUpdate() {
 	CharacterLocation = this->GetActorLocation();
-}
\ No newline at end of file
+}
+
+void AMyCharacter::ChunkLocationUpdate() {
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	float chunk_length = static_cast<float>(DataSystem->get_ground_block_size() * DataSystem->get_chunk_size());
+	if (chunk_length <= 0.f) return;
+	FVector Location = GetActorLocation();
+	int32 chunk_x = FMath::FloorToInt(Location.X / chunk_length);
+	int32 chunk_y = FMath::FloorToInt(Location.Y / chunk_length);
+	if (chunk_x == chunk_x_ && chunk_y == chunk_y_) return;
+	chunk_x_ = chunk_x;
+	chunk_y_ = chunk_y;
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnPlayerChunkChanged, chunk_x_, chunk_y_);
+}
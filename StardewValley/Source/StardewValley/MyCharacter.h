@@ -83,6 +83,12 @@ private:
 
 	void CharacterLocationUpdate();
 
+	//Broadcast when the character enters another chunk of the map
+	void ChunkLocationUpdate();
+
+	int32 chunk_x_ = INDEX_NONE;
+	int32 chunk_y_ = INDEX_NONE;
+
 	int32 now_shortcut_;
 
 	float default_axe_range_ = 200.0f;
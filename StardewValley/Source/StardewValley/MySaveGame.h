@@ -1,6 +1,6 @@
 /****************************************************************
  * \file   MySaveGame.h
- * \brief  Saves and loads game data
+ * \brief  The old save. It is only read, to convert the slots saved before the binary format (SaveFormat.h).
  * 
  * \author 4_of_Diamonds
  * \date   November 2024
@@ -36,7 +36,9 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
 	int32 ground_block_y_length_;
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
-	TArray<FString> ground_block_type_;
+	TArray<FString> ground_block_type_;//Only in old saves, the names of the ground types
+	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
+	TArray<uint8> ground_block_type_code_;//EGroundType of each ground block
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
 	TArray<int32> ground_block_delta_temperature_;
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
@@ -46,6 +48,8 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
 	bool is_items_initialized_;
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
+	int32 map_seed_;
+	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
 	TArray<int32> item_block_lived_time_;
 	UPROPERTY(VisibleAnywhere, Category = "SaveGame")
 	TArray<int32> item_block_durability_;
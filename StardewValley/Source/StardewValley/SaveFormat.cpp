@@ -0,0 +1,929 @@
+/*****************************************************************//**
+ * \file   SaveFormat.cpp
+ * \brief  The implementation of the save format
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "SaveFormat.h"
+#include "MySaveGame.h"
+#include "Misc/Compression.h"
+#include "Misc/Crc.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/LargeMemoryReader.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Write save"), STAT_WriteSave, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Read save"), STAT_ReadSave, STATGROUP_Game);
+
+constexpr uint32 FSaveFormat::kMagic;
+constexpr uint32 FSaveFormat::kJournalMagic;
+constexpr uint16 FSaveFormat::kCurrentVersion;
+constexpr int32 FSaveFormat::kThumbnailLength;
+constexpr int32 FSaveFormat::kChunkLength;
+constexpr int32 FSaveFormat::kMaxLength;
+
+namespace
+{
+	const uint16 kHeaderSize = 21;//The bytes FSaveHeader is written in
+	const uint16 kSlotInfoSize = 7 * 4 + 8 + FSaveFormat::kThumbnailLength * FSaveFormat::kThumbnailLength;//The bytes FSaveSlotInfo is written in
+	const uint16 kSlotSaveIdSize = 4;//The save id behind the slot info, the slot info of older saves ends before it
+	const uint32 kMaxBodySize = 512 * 1024 * 1024;//Larger sections are taken as damage
+	const int32 kJournalHeaderSize = 18;//The bytes the header of a journal record is written in
+
+	template<typename T>
+	void WriteValue(FArchive& archive, T value)
+	{
+		archive << value;
+	}
+	/**
+	 * \brief Write an unsigned number in 7 bits per byte, small numbers take one byte.
+	 */
+	void WriteVarUint(FArchive& archive, uint32 value)
+	{
+		while (value >= 0x80)
+		{
+			WriteValue<uint8>(archive, static_cast<uint8>(value | 0x80));
+			value >>= 7;
+		}
+		WriteValue<uint8>(archive, static_cast<uint8>(value));
+	}
+	uint32 ReadVarUint(FArchive& archive)
+	{
+		uint32 value = 0;
+		for (int32 shift = 0; shift < 35 && !archive.IsError(); shift += 7)
+		{
+			uint8 byte = 0;
+			archive << byte;
+			value |= static_cast<uint32>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)return value;
+		}
+		archive.SetError();
+		return 0;
+	}
+	/**
+	 * \brief Write a signed number so that small negative numbers, like the -1 of an empty field, take one byte too.
+	 */
+	void WriteVarInt(FArchive& archive, int32 value)
+	{
+		WriteVarUint(archive, (static_cast<uint32>(value) << 1) ^ static_cast<uint32>(value >> 31));
+	}
+	int32 ReadVarInt(FArchive& archive)
+	{
+		uint32 value = ReadVarUint(archive);
+		return static_cast<int32>(value >> 1) ^ -static_cast<int32>(value & 1);
+	}
+	/**
+	 * \brief Write a section as its tag, its size and the bytes written by write.
+	 */
+	template<typename FuncType>
+	void WriteSection(FArchive& archive, ESaveSection tag, FuncType&& write)
+	{
+		TArray<uint8> payload;
+		FMemoryWriter PayloadWriter(payload);
+		write(PayloadWriter);
+		WriteValue<uint32>(archive, static_cast<uint32>(tag));
+		WriteValue<uint32>(archive, static_cast<uint32>(payload.Num()));
+		archive.Serialize(payload.GetData(), payload.Num());
+	}
+}
+
+void FSaveSnapshot::ResetTiles(int32 x_length, int32 y_length)
+{
+	x_length_ = FMath::Max(x_length, 0);
+	y_length_ = FMath::Max(y_length, 0);
+	ground_type_.Init(EGroundType::None, Num());
+	delta_temperature_.Init(0, Num());
+	item_id_.Init(-1, Num());
+	lived_time_.Init(-1, Num());
+	durability_.Init(-1, Num());
+	is_watered_.Init(false, Num());
+}
+
+bool FSaveFormat::Write(const FSaveSnapshot& snapshot, TArray<uint8>& data)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WriteSave);
+
+	//The chunks first, the chunk index in the sections holds their sizes
+	FSaveChunkIndex chunk_index;
+	chunk_index.chunk_length_ = kChunkLength;
+	chunk_index.chunk_x_count_ = (snapshot.x_length_ + kChunkLength - 1) / kChunkLength;
+	chunk_index.chunk_y_count_ = (snapshot.y_length_ + kChunkLength - 1) / kChunkLength;
+	chunk_index.entries_.SetNum(chunk_index.chunk_x_count_ * chunk_index.chunk_y_count_);
+	TArray<TArray<uint8>> chunks;
+	chunks.SetNum(chunk_index.Num());
+	ParallelFor(chunk_index.Num(), [&snapshot, &chunk_index, &chunks](int32 chunk)
+		{
+			WriteChunk(snapshot, chunk / chunk_index.chunk_y_count_, chunk % chunk_index.chunk_y_count_, chunks[chunk], chunk_index.entries_[chunk]);
+		});
+
+	TArray<uint8> body;
+	FMemoryWriter BodyWriter(body);
+	WriteSections(BodyWriter, snapshot, chunk_index);
+	if (BodyWriter.IsError())
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: Write: Failed to write the sections"));
+		return false;
+	}
+
+	FSaveHeader header;
+	header.magic_ = kMagic;
+	header.version_ = kCurrentVersion;
+	header.header_size_ = kHeaderSize + kSlotInfoSize + kSlotSaveIdSize;
+	header.body_size_ = body.Num();
+	header.body_crc_ = FCrc::MemCrc32(body.GetData(), body.Num());
+	TArray<uint8> stored;
+	header.compression_ = Compress(body, stored);
+	header.stored_size_ = stored.Num();
+
+	//The slot info and the sections straight behind the header, then the chunks one after another
+	FSaveSlotInfo info;
+	MakeSlotInfo(snapshot, info);
+	int64 chunk_bytes = 0;
+	for (const TArray<uint8>& chunk : chunks)
+	{
+		chunk_bytes += chunk.Num();
+	}
+	data.Reset(header.header_size_ + stored.Num() + chunk_bytes);
+	FMemoryWriter Writer(data);
+	Writer << header.magic_ << header.version_ << header.header_size_ << header.compression_ << header.body_size_ << header.stored_size_ << header.body_crc_;
+	check(data.Num() == kHeaderSize);
+	WriteSlotInfo(Writer, info);
+	WriteValue(Writer, info.save_id_);
+	check(data.Num() == header.header_size_);
+	data.Append(stored);
+	for (const TArray<uint8>& chunk : chunks)
+	{
+		data.Append(chunk);
+	}
+	return true;
+}
+
+bool FSaveFormat::Read(const TArray<uint8>& data, FSaveSnapshot& snapshot)
+{
+	if (!ReadMap(data.GetData(), data.Num(), snapshot))return false;
+	if (snapshot.chunk_index_.Num() == 0)return true;
+
+	//Every chunk now, the data system decodes them lazily instead
+	snapshot.ResetTiles(snapshot.x_length_, snapshot.y_length_);
+	for (int32 chunk = 0; chunk < snapshot.chunk_index_.Num(); chunk++)
+	{
+		FSaveSnapshot blocks;
+		int32 x_begin = 0;
+		int32 y_begin = 0;
+		if (!ReadChunk(data.GetData(), data.Num(), snapshot, chunk, blocks, x_begin, y_begin))return false;
+		for (int32 x = 0; x < blocks.x_length_; x++)
+			for (int32 y = 0, from = x * blocks.y_length_; y < blocks.y_length_; y++, from++)
+			{
+				int32 to = (x_begin + x) * snapshot.y_length_ + y_begin + y;
+				snapshot.ground_type_[to] = blocks.ground_type_[from];
+				snapshot.delta_temperature_[to] = blocks.delta_temperature_[from];
+				snapshot.item_id_[to] = blocks.item_id_[from];
+				snapshot.lived_time_[to] = blocks.lived_time_[from];
+				snapshot.durability_[to] = blocks.durability_[from];
+				snapshot.is_watered_[to] = blocks.is_watered_[from];
+			}
+	}
+	snapshot.chunk_index_ = FSaveChunkIndex();
+	return true;
+}
+
+bool FSaveFormat::ReadMap(const uint8* data, int64 size, FSaveSnapshot& snapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ReadSave);
+
+	FLargeMemoryReader Reader(data, size);
+	FSaveHeader header;
+	if (!ReadHeader(Reader, header))return false;
+	if (header.version_ > kCurrentVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadMap: The save is of version %d, newer than %d"), header.version_, kCurrentVersion);
+		return false;
+	}
+
+	TArray<uint8> body;
+	body.SetNumUninitialized(header.body_size_);
+	if (!Uncompress(header.compression_, data + header.header_size_, header.stored_size_, body))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadMap: Failed to uncompress the sections"));
+		return false;
+	}
+	if (FCrc::MemCrc32(body.GetData(), body.Num()) != header.body_crc_)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadMap: The save is damaged"));
+		return false;
+	}
+
+	FMemoryReader BodyReader(body);
+	snapshot = FSaveSnapshot();
+	if (!ReadSections(BodyReader, header.version_, snapshot))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadMap: Failed to read the sections"));
+		return false;
+	}
+	//The chunks follow the sections
+	snapshot.chunk_index_.version_ = header.version_;
+	int64 chunk_begin = static_cast<int64>(header.header_size_) + header.stored_size_;
+	for (FSaveChunkIndex::FEntry& entry : snapshot.chunk_index_.entries_)
+	{
+		entry.offset_ += chunk_begin;
+		if (entry.offset_ + entry.stored_size_ > size)
+		{
+			UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadMap: The chunks are cut off"));
+			return false;
+		}
+	}
+	if (snapshot.chunk_index_.Num() == 0 && !snapshot.IsTilesSized())snapshot.ResetTiles(snapshot.x_length_, snapshot.y_length_);//A map with no layer sections
+	return true;
+}
+
+bool FSaveFormat::ReadChunk(const uint8* data, int64 size, const FSaveSnapshot& snapshot, int32 chunk, FSaveSnapshot& blocks, int32& x_begin, int32& y_begin)
+{
+	const FSaveChunkIndex& chunk_index = snapshot.chunk_index_;
+	if (!chunk_index.entries_.IsValidIndex(chunk))return false;
+	const FSaveChunkIndex::FEntry& entry = chunk_index.entries_[chunk];
+	x_begin = chunk / chunk_index.chunk_y_count_ * chunk_index.chunk_length_;
+	y_begin = chunk % chunk_index.chunk_y_count_ * chunk_index.chunk_length_;
+	blocks = FSaveSnapshot();
+	blocks.ResetTiles(FMath::Min(chunk_index.chunk_length_, snapshot.x_length_ - x_begin), FMath::Min(chunk_index.chunk_length_, snapshot.y_length_ - y_begin));
+
+	TArray<uint8> body;
+	body.SetNumUninitialized(entry.body_size_);
+	if (entry.offset_ + entry.stored_size_ > size || !Uncompress(entry.compression_, data + entry.offset_, entry.stored_size_, body) || FCrc::MemCrc32(body.GetData(), body.Num()) != entry.body_crc_)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadChunk: Chunk %d is damaged"), chunk);
+		return false;
+	}
+	FMemoryReader BodyReader(body);
+	return ReadSections(BodyReader, chunk_index.version_, blocks);
+}
+
+bool FSaveFormat::IsSaveData(const TArray<uint8>& data)
+{
+	return IsSaveData(data.GetData(), data.Num());
+}
+
+bool FSaveFormat::IsSaveData(const uint8* data, int64 size)
+{
+	if (size < static_cast<int64>(sizeof(uint32)))return false;
+	uint32 magic = 0;
+	FLargeMemoryReader Reader(data, size);
+	Reader << magic;
+	return magic == kMagic;
+}
+
+void FSaveFormat::ReadLegacy(const UMySaveGame* legacy, FSaveSnapshot& snapshot)
+{
+	snapshot = FSaveSnapshot();
+	snapshot.minute_ = legacy->minute_;
+	snapshot.hour_ = legacy->hour_;
+	snapshot.day_in_season_ = legacy->day_in_season_;
+	snapshot.season_ = legacy->season_;
+	snapshot.real_time_ = legacy->real_time_;
+	snapshot.weather_ = legacy->weather_;
+	snapshot.base_temperature_ = legacy->base_temperature_;
+	snapshot.ground_block_size_ = legacy->ground_block_size_;
+	snapshot.map_seed_ = legacy->map_seed_;
+	snapshot.is_items_initialized_ = legacy->is_items_initialized_;
+	snapshot.ResetTiles(FMath::Clamp(legacy->ground_block_x_length_, 0, kMaxLength), FMath::Clamp(legacy->ground_block_y_length_, 0, kMaxLength));
+	bool is_old_save = legacy->ground_block_type_code_.Num() < snapshot.Num();
+	for (int32 i = 0; i < snapshot.Num(); i++)
+	{
+		if (is_old_save)snapshot.ground_type_[i] = legacy->ground_block_type_.IsValidIndex(i) ? StringToGroundType(legacy->ground_block_type_[i]) : EGroundType::None;
+		else snapshot.ground_type_[i] = static_cast<EGroundType>(legacy->ground_block_type_code_[i]);
+	}
+	for (int32 i = 0; i < snapshot.Num(); i++)
+	{
+		if (legacy->item_block_id_.IsValidIndex(i))snapshot.item_id_[i] = legacy->item_block_id_[i];
+		if (legacy->item_block_lived_time_.IsValidIndex(i))snapshot.lived_time_[i] = legacy->item_block_lived_time_[i];
+		if (legacy->item_block_durability_.IsValidIndex(i))snapshot.durability_[i] = legacy->item_block_durability_[i];
+		if (legacy->is_item_block_watered_.IsValidIndex(i))snapshot.is_watered_[i] = legacy->is_item_block_watered_[i];
+	}
+	snapshot.player_axe_level_ = legacy->player_axe_level_;
+	snapshot.player_hoe_level_ = legacy->player_hoe_level_;
+	snapshot.player_scythe_level_ = legacy->player_scythe_level_;
+	snapshot.player_axe_exp_ = legacy->player_axe_exp_;
+	snapshot.player_hoe_exp_ = legacy->player_hoe_exp_;
+	snapshot.player_scythe_exp_ = legacy->player_scythe_exp_;
+	snapshot.player_bag_ = legacy->player_bag_;
+}
+
+void FSaveFormat::WriteJournalRecord(const FSaveDelta& delta, TArray<uint8>& record)
+{
+	TArray<uint8> body;
+	FMemoryWriter BodyWriter(body);
+	WriteSection(BodyWriter, ESaveSection::Time, [&delta](FArchive& section) { WriteTime(section, delta.state_); });
+	WriteSection(BodyWriter, ESaveSection::Weather, [&delta](FArchive& section) { WriteWeather(section, delta.state_); });
+	if (delta.is_player_changed_)WriteSection(BodyWriter, ESaveSection::Player, [&delta](FArchive& section) { WritePlayer(section, delta.state_); });
+	WriteSection(BodyWriter, ESaveSection::Focus, [&delta](FArchive& section) { WriteFocus(section, delta.state_); });
+	WriteSection(BodyWriter, ESaveSection::Tiles, [&delta](FArchive& section) { WriteTiles(section, delta.tiles_); });
+	WriteValue<uint32>(BodyWriter, static_cast<uint32>(ESaveSection::End));
+
+	//The records are small, so they are not compressed
+	record.Reset(kJournalHeaderSize + body.Num());
+	FMemoryWriter Writer(record);
+	WriteValue(Writer, kJournalMagic);
+	WriteValue(Writer, kCurrentVersion);
+	WriteValue(Writer, delta.save_id_);
+	WriteValue<uint32>(Writer, body.Num());
+	WriteValue(Writer, FCrc::MemCrc32(body.GetData(), body.Num()));
+	Writer.Serialize(body.GetData(), body.Num());
+}
+
+int32 FSaveFormat::ReadJournal(const TArray<uint8>& journal, FSaveSnapshot& snapshot, bool& is_complete)
+{
+	FMemoryReader Reader(journal);
+	int32 record_count = 0;
+	is_complete = false;
+	while (Reader.Tell() < Reader.TotalSize())
+	{
+		if (Reader.TotalSize() - Reader.Tell() < kJournalHeaderSize)return record_count;//A header cut off
+		uint32 magic = 0;
+		uint16 version = 0;
+		uint32 save_id = 0;
+		uint32 size = 0;
+		uint32 crc = 0;
+		Reader << magic << version << save_id << size << crc;
+		if (magic != kJournalMagic || version > kCurrentVersion || size > Reader.TotalSize() - Reader.Tell())return record_count;
+		const uint8* body_data = journal.GetData() + Reader.Tell();
+		Reader.Seek(Reader.Tell() + size);
+		if (save_id != snapshot.save_id_)continue;//Left over from an older full save
+		if (FCrc::MemCrc32(body_data, size) != crc)return record_count;
+
+		//The crc has passed, so a record that fails to read is a bug, not a cut off write
+		TArray<uint8> body(body_data, size);
+		FMemoryReader BodyReader(body);
+		if (!ReadSections(BodyReader, version, snapshot))
+		{
+			UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadJournal: Failed to read record %d"), record_count);
+			return record_count;
+		}
+		record_count++;
+	}
+	is_complete = true;
+	return record_count;
+}
+
+bool FSaveFormat::ReadSlotInfo(FArchive& archive, FSaveSlotInfo& info)
+{
+	//An old UMySaveGame slot is no error here, the slot list meets them
+	uint32 magic = 0;
+	archive << magic;
+	if (archive.IsError() || magic != kMagic)return false;
+	archive.Seek(0);
+
+	FSaveHeader header;
+	if (!ReadHeader(archive, header))return false;
+	info.is_info_saved_ = false;
+	if (header.header_size_ < kHeaderSize + kSlotInfoSize)return true;//Saved before the slot info
+
+	archive.Seek(kHeaderSize);
+	ReadSlotInfoFields(archive, info);
+	if (header.header_size_ >= kHeaderSize + kSlotInfoSize + kSlotSaveIdSize)archive << info.save_id_;
+	info.is_info_saved_ = !archive.IsError();
+	return true;
+}
+
+int32 FSaveFormat::ReadJournalSlotInfo(const TArray<uint8>& journal, FSaveSlotInfo& info)
+{
+	if (!info.is_info_saved_ || info.save_id_ == 0)return 0;//The records can not be told to follow this save
+	//Only the sizes of the map, the blocks of the records are kept aside and dropped
+	FSaveSnapshot snapshot;
+	snapshot.save_id_ = info.save_id_;
+	snapshot.x_length_ = info.x_length_;
+	snapshot.y_length_ = info.y_length_;
+	bool is_complete = false;
+	int32 record_count = ReadJournal(journal, snapshot, is_complete);
+	if (record_count == 0)return 0;
+	info.season_ = snapshot.season_;
+	info.day_in_season_ = snapshot.day_in_season_;
+	info.hour_ = snapshot.hour_;
+	info.minute_ = snapshot.minute_;
+	info.real_time_ = snapshot.real_time_;
+	return record_count;
+}
+
+bool FSaveFormat::ReadHeader(FArchive& archive, FSaveHeader& header)
+{
+	archive << header.magic_ << header.version_ << header.header_size_ << header.compression_ << header.body_size_ << header.stored_size_ << header.body_crc_;
+	if (archive.IsError() || header.magic_ != kMagic)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadHeader: Not a save"));
+		return false;
+	}
+	//A newer header may be longer, the fields it adds are skipped
+	if (header.header_size_ < kHeaderSize || static_cast<int64>(header.header_size_) + header.stored_size_ > archive.TotalSize() || header.body_size_ > kMaxBodySize)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SaveFormat.cpp: ReadHeader: The header is damaged"));
+		return false;
+	}
+	archive.Seek(header.header_size_);
+	return true;
+}
+
+void FSaveFormat::MakeSlotInfo(const FSaveSnapshot& snapshot, FSaveSlotInfo& info)
+{
+	info.season_ = snapshot.season_;
+	info.day_in_season_ = snapshot.day_in_season_;
+	info.hour_ = snapshot.hour_;
+	info.minute_ = snapshot.minute_;
+	info.real_time_ = snapshot.real_time_;
+	info.x_length_ = snapshot.x_length_;
+	info.y_length_ = snapshot.y_length_;
+	info.saved_at_ = FDateTime::UtcNow().GetTicks();
+	info.save_id_ = snapshot.save_id_;
+	info.thumbnail_.Init(EGroundType::None, kThumbnailLength * kThumbnailLength);
+	if (snapshot.Num() == 0)return;
+	for (int32 x = 0; x < kThumbnailLength; x++)
+	{
+		int32 map_x = static_cast<int32>(static_cast<int64>(x) * snapshot.x_length_ / kThumbnailLength);
+		for (int32 y = 0; y < kThumbnailLength; y++)
+		{
+			int32 map_y = static_cast<int32>(static_cast<int64>(y) * snapshot.y_length_ / kThumbnailLength);
+			info.thumbnail_[x * kThumbnailLength + y] = snapshot.ground_type_[map_x * snapshot.y_length_ + map_y];
+		}
+	}
+}
+
+void FSaveFormat::WriteSlotInfo(FArchive& archive, const FSaveSlotInfo& info)
+{
+	//Fixed size, every field is written even if it is 0
+	WriteValue(archive, info.season_);
+	WriteValue(archive, info.day_in_season_);
+	WriteValue(archive, info.hour_);
+	WriteValue(archive, info.minute_);
+	WriteValue(archive, info.real_time_);
+	WriteValue(archive, info.x_length_);
+	WriteValue(archive, info.y_length_);
+	WriteValue(archive, info.saved_at_);
+	for (int32 i = 0; i < kThumbnailLength * kThumbnailLength; i++)
+	{
+		WriteValue<uint8>(archive, static_cast<uint8>(info.thumbnail_.IsValidIndex(i) ? info.thumbnail_[i] : EGroundType::None));
+	}
+}
+
+void FSaveFormat::ReadSlotInfoFields(FArchive& archive, FSaveSlotInfo& info)
+{
+	archive << info.season_ << info.day_in_season_ << info.hour_ << info.minute_ << info.real_time_ << info.x_length_ << info.y_length_ << info.saved_at_;
+	TArray<uint8> pixels;
+	pixels.SetNumUninitialized(kThumbnailLength * kThumbnailLength);
+	archive.Serialize(pixels.GetData(), pixels.Num());
+	info.thumbnail_.SetNumUninitialized(pixels.Num());
+	for (int32 i = 0; i < pixels.Num(); i++)
+	{
+		info.thumbnail_[i] = pixels[i] < static_cast<uint8>(EGroundType::Count) ? static_cast<EGroundType>(pixels[i]) : EGroundType::None;
+	}
+}
+
+void FSaveFormat::WriteSections(FArchive& archive, const FSaveSnapshot& snapshot, const FSaveChunkIndex& chunk_index)
+{
+	WriteSection(archive, ESaveSection::SaveId, [&snapshot](FArchive& section) { WriteValue(section, snapshot.save_id_); });
+	WriteSection(archive, ESaveSection::Time, [&snapshot](FArchive& section) { WriteTime(section, snapshot); });
+	WriteSection(archive, ESaveSection::Weather, [&snapshot](FArchive& section) { WriteWeather(section, snapshot); });
+	WriteSection(archive, ESaveSection::Map, [&snapshot](FArchive& section)
+		{
+			WriteValue(section, snapshot.x_length_);
+			WriteValue(section, snapshot.y_length_);
+			WriteValue(section, snapshot.ground_block_size_);
+			WriteValue(section, snapshot.map_seed_);
+			WriteValue<uint8>(section, snapshot.is_items_initialized_ ? 1 : 0);
+		});
+	WriteSection(archive, ESaveSection::ChunkIndex, [&snapshot, &chunk_index](FArchive& section)
+		{
+			WriteValue(section, chunk_index.chunk_length_);
+			WriteValue(section, chunk_index.chunk_x_count_);
+			WriteValue(section, chunk_index.chunk_y_count_);
+			WriteValue<uint8>(section, snapshot.is_temperature_saved_ ? 1 : 0);
+			for (const FSaveChunkIndex::FEntry& entry : chunk_index.entries_)
+			{
+				//The offsets are the sum of the sizes before
+				WriteVarUint(section, entry.stored_size_);
+				WriteVarUint(section, entry.body_size_);
+				WriteValue(section, entry.body_crc_);
+				WriteValue(section, entry.compression_);
+			}
+		});
+	WriteSection(archive, ESaveSection::Player, [&snapshot](FArchive& section) { WritePlayer(section, snapshot); });
+	WriteSection(archive, ESaveSection::Focus, [&snapshot](FArchive& section) { WriteFocus(section, snapshot); });
+	WriteValue<uint32>(archive, static_cast<uint32>(ESaveSection::End));
+}
+
+void FSaveFormat::WriteChunk(const FSaveSnapshot& snapshot, int32 chunk_x, int32 chunk_y, TArray<uint8>& stored, FSaveChunkIndex::FEntry& entry)
+{
+	//The blocks of the chunk are copied out, so the layer sections are written as for a small map
+	int32 x_begin = chunk_x * kChunkLength;
+	int32 y_begin = chunk_y * kChunkLength;
+	FSaveSnapshot blocks;
+	blocks.ResetTiles(FMath::Min(kChunkLength, snapshot.x_length_ - x_begin), FMath::Min(kChunkLength, snapshot.y_length_ - y_begin));
+	blocks.is_temperature_saved_ = snapshot.is_temperature_saved_;
+	for (int32 x = 0; x < blocks.x_length_; x++)
+		for (int32 y = 0, to = x * blocks.y_length_; y < blocks.y_length_; y++, to++)
+		{
+			int32 from = (x_begin + x) * snapshot.y_length_ + y_begin + y;
+			blocks.ground_type_[to] = snapshot.ground_type_[from];
+			blocks.delta_temperature_[to] = snapshot.delta_temperature_[from];
+			blocks.item_id_[to] = snapshot.item_id_[from];
+			blocks.lived_time_[to] = snapshot.lived_time_[from];
+			blocks.durability_[to] = snapshot.durability_[from];
+			blocks.is_watered_[to] = snapshot.is_watered_[from];
+		}
+
+	TArray<uint8> body;
+	FMemoryWriter BodyWriter(body);
+	WriteSection(BodyWriter, ESaveSection::Ground, [&blocks](FArchive& section) { WriteGround(section, blocks); });
+	if (blocks.is_temperature_saved_)WriteSection(BodyWriter, ESaveSection::Temperature, [&blocks](FArchive& section) { WriteTemperature(section, blocks); });
+	WriteSection(BodyWriter, ESaveSection::Items, [&blocks](FArchive& section) { WriteItems(section, blocks); });
+	WriteValue<uint32>(BodyWriter, static_cast<uint32>(ESaveSection::End));
+
+	entry.body_size_ = body.Num();
+	entry.body_crc_ = FCrc::MemCrc32(body.GetData(), body.Num());
+	entry.compression_ = Compress(body, stored);
+	entry.stored_size_ = stored.Num();
+}
+
+uint8 FSaveFormat::Compress(const TArray<uint8>& body, TArray<uint8>& stored)
+{
+	FName method = CompressionToName(kCompression);
+	int32 stored_size = FCompression::CompressMemoryBound(method, body.Num());
+	stored.SetNumUninitialized(stored_size);
+	if (!FCompression::CompressMemory(method, stored.GetData(), stored_size, body.GetData(), body.Num()) || stored_size >= body.Num())
+	{
+		//Not worth it, stored as it is
+		stored = body;
+		return 0;
+	}
+	stored.SetNum(stored_size, false);
+	return kCompression;
+}
+
+bool FSaveFormat::Uncompress(uint8 compression, const uint8* stored, int64 stored_size, TArray<uint8>& body)
+{
+	if (compression == 0)
+	{
+		if (stored_size != body.Num())return false;
+		FMemory::Memcpy(body.GetData(), stored, stored_size);
+		return true;
+	}
+	return FCompression::UncompressMemory(CompressionToName(compression), body.GetData(), body.Num(), stored, stored_size);
+}
+
+bool FSaveFormat::ReadSections(FArchive& archive, int32 version, FSaveSnapshot& snapshot)
+{
+	//A section whose layout has changed reads by the version
+	while (!archive.AtEnd() && !archive.IsError())
+	{
+		uint32 tag = 0;
+		uint32 size = 0;
+		archive << tag;
+		if (tag == static_cast<uint32>(ESaveSection::End))return !archive.IsError();
+		archive << size;
+		int64 end = archive.Tell() + size;
+		if (archive.IsError() || end > archive.TotalSize())return false;
+
+		switch (static_cast<ESaveSection>(tag))
+		{
+		case ESaveSection::SaveId:
+			archive << snapshot.save_id_;
+			break;
+		case ESaveSection::Time:
+			archive << snapshot.minute_ << snapshot.hour_ << snapshot.day_in_season_ << snapshot.season_ << snapshot.real_time_;
+			break;
+		case ESaveSection::Weather:
+			archive << snapshot.weather_ << snapshot.base_temperature_;
+			break;
+		case ESaveSection::Map:
+		{
+			int32 x_length = 0;
+			int32 y_length = 0;
+			uint8 is_items_initialized = 0;
+			archive << x_length << y_length << snapshot.ground_block_size_ << snapshot.map_seed_ << is_items_initialized;
+			if (x_length < 0 || y_length < 0 || x_length > kMaxLength || y_length > kMaxLength)return false;
+			snapshot.is_items_initialized_ = is_items_initialized != 0;
+			snapshot.x_length_ = x_length;//The layers are sized by the sections that fill them
+			snapshot.y_length_ = y_length;
+			break;
+		}
+		case ESaveSection::ChunkIndex:
+			ReadChunkIndex(archive, snapshot);
+			break;
+		case ESaveSection::Focus:
+			archive << snapshot.player_chunk_x_ << snapshot.player_chunk_y_;
+			break;
+		case ESaveSection::Ground:
+			ReadGround(archive, snapshot);
+			break;
+		case ESaveSection::Items:
+			ReadItems(archive, snapshot);
+			break;
+		case ESaveSection::Temperature:
+			ReadTemperature(archive, snapshot);
+			break;
+		case ESaveSection::Tiles:
+			ReadTiles(archive, version, snapshot);
+			break;
+		case ESaveSection::Player:
+		{
+			archive << snapshot.player_axe_level_ << snapshot.player_hoe_level_ << snapshot.player_scythe_level_;
+			archive << snapshot.player_axe_exp_ << snapshot.player_hoe_exp_ << snapshot.player_scythe_exp_;
+			uint32 bag_num = ReadVarUint(archive);
+			snapshot.player_bag_.Empty(bag_num);
+			for (uint32 i = 0; i < bag_num && !archive.IsError(); i++)
+			{
+				int32 id = ReadVarInt(archive);
+				int32 amount = ReadVarInt(archive);
+				snapshot.player_bag_.Add(id, amount);
+			}
+			break;
+		}
+		default:
+			break;//A section of a newer version, skipped
+		}
+		if (archive.IsError() || archive.Tell() > end)return false;
+		archive.Seek(end);
+	}
+	return false;//No end tag
+}
+
+void FSaveFormat::WriteTime(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	WriteValue(archive, snapshot.minute_);
+	WriteValue(archive, snapshot.hour_);
+	WriteValue(archive, snapshot.day_in_season_);
+	WriteValue(archive, snapshot.season_);
+	WriteValue(archive, snapshot.real_time_);
+}
+
+void FSaveFormat::WriteWeather(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	WriteValue(archive, snapshot.weather_);
+	WriteValue(archive, snapshot.base_temperature_);
+}
+
+void FSaveFormat::WritePlayer(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	WriteValue(archive, snapshot.player_axe_level_);
+	WriteValue(archive, snapshot.player_hoe_level_);
+	WriteValue(archive, snapshot.player_scythe_level_);
+	WriteValue(archive, snapshot.player_axe_exp_);
+	WriteValue(archive, snapshot.player_hoe_exp_);
+	WriteValue(archive, snapshot.player_scythe_exp_);
+	WriteVarUint(archive, snapshot.player_bag_.Num());
+	for (const auto& it : snapshot.player_bag_)
+	{
+		WriteVarInt(archive, it.Key);
+		WriteVarInt(archive, it.Value);
+	}
+}
+
+void FSaveFormat::WriteFocus(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	WriteValue(archive, snapshot.player_chunk_x_);
+	WriteValue(archive, snapshot.player_chunk_y_);
+}
+
+void FSaveFormat::ReadChunkIndex(FArchive& archive, FSaveSnapshot& snapshot)
+{
+	FSaveChunkIndex& chunk_index = snapshot.chunk_index_;
+	uint8 is_temperature_saved = 0;
+	archive << chunk_index.chunk_length_ << chunk_index.chunk_x_count_ << chunk_index.chunk_y_count_ << is_temperature_saved;
+	if (archive.IsError() || chunk_index.chunk_length_ <= 0
+		|| chunk_index.chunk_x_count_ != (snapshot.x_length_ + chunk_index.chunk_length_ - 1) / chunk_index.chunk_length_
+		|| chunk_index.chunk_y_count_ != (snapshot.y_length_ + chunk_index.chunk_length_ - 1) / chunk_index.chunk_length_)
+	{
+		archive.SetError();//Not of the map read before
+		return;
+	}
+	snapshot.is_temperature_saved_ = is_temperature_saved != 0;
+	chunk_index.entries_.SetNum(chunk_index.chunk_x_count_ * chunk_index.chunk_y_count_);
+	int64 offset = 0;
+	for (FSaveChunkIndex::FEntry& entry : chunk_index.entries_)
+	{
+		entry.offset_ = offset;//From the first chunk, ReadMap makes it from the start of the save
+		entry.stored_size_ = ReadVarUint(archive);
+		entry.body_size_ = ReadVarUint(archive);
+		archive << entry.body_crc_ << entry.compression_;
+		if (archive.IsError() || entry.body_size_ > kMaxBodySize)
+		{
+			archive.SetError();
+			return;
+		}
+		offset += entry.stored_size_;
+	}
+}
+
+void FSaveFormat::WriteGround(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	//As few bits per block as the largest type needs
+	uint8 max_type = 0;
+	for (EGroundType type : snapshot.ground_type_)
+	{
+		max_type = FMath::Max(max_type, static_cast<uint8>(type));
+	}
+	uint8 bits = static_cast<uint8>(FMath::Max<uint32>(FMath::CeilLogTwo(static_cast<uint32>(max_type) + 1), 1));
+	WriteValue(archive, bits);
+
+	TArray<uint8> packed;
+	packed.Reserve((snapshot.Num() * bits + 7) / 8);
+	uint64 buffer = 0;
+	int32 buffer_bits = 0;
+	for (EGroundType type : snapshot.ground_type_)
+	{
+		buffer |= static_cast<uint64>(type) << buffer_bits;
+		buffer_bits += bits;
+		while (buffer_bits >= 8)
+		{
+			packed.Add(static_cast<uint8>(buffer));
+			buffer >>= 8;
+			buffer_bits -= 8;
+		}
+	}
+	if (buffer_bits > 0)packed.Add(static_cast<uint8>(buffer));
+	archive.Serialize(packed.GetData(), packed.Num());
+}
+
+void FSaveFormat::ReadGround(FArchive& archive, FSaveSnapshot& snapshot)
+{
+	if (!snapshot.IsTilesSized())snapshot.ResetTiles(snapshot.x_length_, snapshot.y_length_);
+	uint8 bits = 0;
+	archive << bits;
+	if (bits < 1 || bits > 8)
+	{
+		archive.SetError();
+		return;
+	}
+	TArray<uint8> packed;
+	packed.SetNumUninitialized((snapshot.Num() * bits + 7) / 8);
+	archive.Serialize(packed.GetData(), packed.Num());
+	if (archive.IsError())return;
+
+	const uint32 mask = (1u << bits) - 1;
+	uint64 buffer = 0;
+	int32 buffer_bits = 0;
+	int32 byte_index = 0;
+	for (int32 i = 0; i < snapshot.Num(); i++)
+	{
+		while (buffer_bits < bits)
+		{
+			buffer |= static_cast<uint64>(packed[byte_index++]) << buffer_bits;
+			buffer_bits += 8;
+		}
+		uint32 code = static_cast<uint32>(buffer) & mask;
+		buffer >>= bits;
+		buffer_bits -= bits;
+		snapshot.ground_type_[i] = code < static_cast<uint32>(EGroundType::Count) ? static_cast<EGroundType>(code) : EGroundType::None;
+	}
+}
+
+void FSaveFormat::WriteItems(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	//Only the blocks with a field other than the empty value, each after the gap from the previous one
+	int32 record_num = 0;
+	for (int32 i = 0; i < snapshot.Num(); i++)
+	{
+		if (snapshot.item_id_[i] != -1 || snapshot.lived_time_[i] != -1 || snapshot.durability_[i] != -1 || snapshot.is_watered_[i])record_num++;
+	}
+	WriteVarUint(archive, record_num);
+	int32 next_index = 0;
+	for (int32 i = 0; i < snapshot.Num(); i++)
+	{
+		if (snapshot.item_id_[i] == -1 && snapshot.lived_time_[i] == -1 && snapshot.durability_[i] == -1 && !snapshot.is_watered_[i])continue;
+		WriteVarUint(archive, i - next_index);
+		WriteVarInt(archive, snapshot.item_id_[i]);
+		WriteVarInt(archive, snapshot.lived_time_[i]);
+		WriteVarInt(archive, snapshot.durability_[i]);
+		WriteValue<uint8>(archive, snapshot.is_watered_[i] ? 1 : 0);
+		next_index = i + 1;
+	}
+}
+
+void FSaveFormat::ReadItems(FArchive& archive, FSaveSnapshot& snapshot)
+{
+	if (!snapshot.IsTilesSized())snapshot.ResetTiles(snapshot.x_length_, snapshot.y_length_);
+	uint32 record_num = ReadVarUint(archive);
+	int64 index = 0;
+	for (uint32 record = 0; record < record_num && !archive.IsError(); record++)
+	{
+		index += ReadVarUint(archive);
+		if (index >= snapshot.Num())
+		{
+			archive.SetError();
+			return;
+		}
+		snapshot.item_id_[index] = ReadVarInt(archive);
+		snapshot.lived_time_[index] = ReadVarInt(archive);
+		snapshot.durability_[index] = ReadVarInt(archive);
+		uint8 is_watered = 0;
+		archive << is_watered;
+		snapshot.is_watered_[index] = is_watered != 0;
+		index++;
+	}
+}
+
+void FSaveFormat::WriteTemperature(FArchive& archive, const FSaveSnapshot& snapshot)
+{
+	//Only the blocks near fires are warmer, so the layer is long runs of 0
+	for (int32 i = 0; i < snapshot.Num();)
+	{
+		int32 value = snapshot.delta_temperature_[i];
+		int32 run = 1;
+		while (i + run < snapshot.Num() && snapshot.delta_temperature_[i + run] == value)run++;
+		WriteVarInt(archive, value);
+		WriteVarUint(archive, run);
+		i += run;
+	}
+}
+
+void FSaveFormat::ReadTemperature(FArchive& archive, FSaveSnapshot& snapshot)
+{
+	if (!snapshot.IsTilesSized())snapshot.ResetTiles(snapshot.x_length_, snapshot.y_length_);
+	for (int32 i = 0; i < snapshot.Num() && !archive.IsError();)
+	{
+		int32 value = ReadVarInt(archive);
+		uint32 run = ReadVarUint(archive);
+		if (run == 0 || run > static_cast<uint32>(snapshot.Num() - i))
+		{
+			archive.SetError();
+			return;
+		}
+		for (uint32 j = 0; j < run; j++, i++)
+		{
+			snapshot.delta_temperature_[i] = value;
+		}
+	}
+	snapshot.is_temperature_saved_ = true;
+}
+
+void FSaveFormat::WriteTiles(FArchive& archive, const TArray<FSaveTile>& tiles)
+{
+	WriteVarUint(archive, tiles.Num());
+	int32 next_index = 0;
+	for (const FSaveTile& tile : tiles)
+	{
+		WriteVarUint(archive, tile.index_ - next_index);
+		WriteValue<uint8>(archive, static_cast<uint8>(tile.ground_type_));
+		WriteVarInt(archive, tile.delta_temperature_);
+		WriteVarInt(archive, tile.item_id_);
+		WriteVarInt(archive, tile.lived_time_);
+		WriteVarInt(archive, tile.durability_);
+		WriteValue<uint8>(archive, tile.is_watered_ ? 1 : 0);
+		next_index = tile.index_ + 1;
+	}
+}
+
+void FSaveFormat::ReadTiles(FArchive& archive, int32 version, FSaveSnapshot& snapshot)
+{
+	//Over a save whose chunks are not decoded yet, the blocks are kept to be applied after their chunks
+	const bool is_pending = !snapshot.IsTilesSized();
+	uint32 tile_num = ReadVarUint(archive);
+	int64 index = 0;
+	for (uint32 i = 0; i < tile_num && !archive.IsError(); i++)
+	{
+		index += ReadVarUint(archive);
+		if (index >= snapshot.Num())
+		{
+			archive.SetError();
+			return;
+		}
+		FSaveTile tile;
+		tile.index_ = static_cast<int32>(index);
+		uint8 ground_type = 0;
+		archive << ground_type;
+		tile.ground_type_ = ground_type < static_cast<uint8>(EGroundType::Count) ? static_cast<EGroundType>(ground_type) : EGroundType::None;
+		if (version >= 2)tile.delta_temperature_ = ReadVarInt(archive);
+		tile.item_id_ = ReadVarInt(archive);
+		tile.lived_time_ = ReadVarInt(archive);
+		tile.durability_ = ReadVarInt(archive);
+		uint8 is_watered = 0;
+		archive << is_watered;
+		tile.is_watered_ = is_watered != 0;
+		if (is_pending)
+		{
+			snapshot.pending_tiles_.Add(tile);
+		}
+		else
+		{
+			snapshot.ground_type_[index] = tile.ground_type_;
+			if (version >= 2)snapshot.delta_temperature_[index] = tile.delta_temperature_;
+			snapshot.item_id_[index] = tile.item_id_;
+			snapshot.lived_time_[index] = tile.lived_time_;
+			snapshot.durability_[index] = tile.durability_;
+			snapshot.is_watered_[index] = tile.is_watered_;
+		}
+		index++;
+	}
+}
+
+FName FSaveFormat::CompressionToName(uint8 compression)
+{
+	switch (compression)
+	{
+	case 1:
+		return NAME_Zlib;
+	case 2:
+		return NAME_LZ4;
+	default:
+		return NAME_None;
+	}
+}
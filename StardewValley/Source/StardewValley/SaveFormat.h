@@ -0,0 +1,320 @@
+/*****************************************************************
+ * \file   SaveFormat.h
+ * \brief  The binary save format. A fixed header, then a compressed list of tagged sections, one per kind of data.
+ * \brief  The ground is bit-packed and the items are stored only where there is one. Unknown sections are skipped,
+ * \brief  so new layers are added as new sections. Older versions are read by the readers branching on the version.
+ * \brief  The slot info sits uncompressed between the header and the sections, so a slot list reads only the front of each file.
+ * \brief  From version 3 the blocks are stored chunk by chunk behind the sections, each compressed on its own and found
+ * \brief  by the chunk index, so a load decodes the chunks around the player first and the rest later.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GroundType.h"
+#include "SaveFormat.generated.h"
+
+class UMySaveGame;
+
+/**
+ * Where the chunks of the map are in a save. Read from the ChunkIndex section, a save of an older version has no entries.
+ */
+struct FSaveChunkIndex
+{
+	struct FEntry
+	{
+		int64 offset_ = 0;//From the start of the save
+		uint32 stored_size_ = 0;
+		uint32 body_size_ = 0;
+		uint32 body_crc_ = 0;
+		uint8 compression_ = 0;
+	};
+	int32 chunk_length_ = 0;//Blocks on a side of a chunk
+	int32 chunk_x_count_ = 0;
+	int32 chunk_y_count_ = 0;
+	TArray<FEntry> entries_;//index = chunk_x * chunk_y_count_ + chunk_y
+	uint16 version_ = 0;//The version of the save, the chunks are read at it
+
+	int32 Num() const { return entries_.Num(); }
+};
+
+/**
+ * The saved fields of a block.
+ */
+struct FSaveTile
+{
+	int32 index_ = 0;
+	EGroundType ground_type_ = EGroundType::None;
+	int32 delta_temperature_ = 0;
+	int32 item_id_ = -1;
+	int32 lived_time_ = -1;
+	int32 durability_ = -1;
+	bool is_watered_ = false;
+};
+
+/**
+ * Everything a save holds, detached from the data system. Tile layers use the index of FTileStore.
+ */
+struct FSaveSnapshot
+{
+	//Time data
+	int32 minute_ = 0;
+	int32 hour_ = 0;
+	int32 day_in_season_ = 0;
+	int32 season_ = 0;
+	int32 real_time_ = 0;
+	//Weather data
+	int32 weather_ = 0;
+	int32 base_temperature_ = 0;
+	//Map data
+	int32 x_length_ = 0;
+	int32 y_length_ = 0;
+	int32 ground_block_size_ = 0;
+	int32 map_seed_ = 0;
+	bool is_items_initialized_ = false;
+	TArray<EGroundType> ground_type_;
+	TArray<int32> delta_temperature_;
+	bool is_temperature_saved_ = false;//Older saves have no temperature, it is rebuilt from the fires
+	TArray<int32> item_id_;
+	TArray<int32> lived_time_;
+	TArray<int32> durability_;
+	TArray<bool> is_watered_;
+	FSaveChunkIndex chunk_index_;//Only read. If it has entries, the layers are empty until the chunks are decoded
+	TArray<FSaveTile> pending_tiles_;//Blocks of the journal read before the chunks are decoded, in the order read
+	//Player data
+	int32 player_axe_level_ = 0;
+	int32 player_hoe_level_ = 0;
+	int32 player_scythe_level_ = 0;
+	int32 player_axe_exp_ = 0;
+	int32 player_hoe_exp_ = 0;
+	int32 player_scythe_exp_ = 0;
+	TMap<int32, int32> player_bag_;
+	int32 player_chunk_x_ = -1;//The chunk the player was in, -1 if unknown
+	int32 player_chunk_y_ = -1;
+	uint32 save_id_ = 0;
+
+	int32 Num() const { return x_length_ * y_length_; }
+	bool IsTilesSized() const { return ground_type_.Num() == Num(); }
+	/**
+	 * \brief Size the tile layers for the map and fill them with the empty values.
+	 */
+	void ResetTiles(int32 x_length, int32 y_length);
+};
+
+/**
+ * What has changed since the last save, appended to the journal of a full save.
+ */
+struct FSaveDelta
+{
+	uint32 save_id_ = 0;//Of the full save it follows
+	FSaveSnapshot state_;//The time, weather and player data, its layers are empty
+	bool is_player_changed_ = false;
+	TArray<FSaveTile> tiles_;//Sorted by index
+};
+
+/**
+ * What a slot list shows of a save. Written in a fixed size behind the header, so it is read without the sections.
+ * The title screen gets it from USaveSlotManager::GetSlots.
+ */
+USTRUCT(BlueprintType)
+struct FSaveSlotInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FString slot_name_;//Not written, the name of the file
+	UPROPERTY(BlueprintReadOnly)
+	int32 season_ = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 day_in_season_ = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 hour_ = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 minute_ = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 real_time_ = 0;//The play time
+	UPROPERTY(BlueprintReadOnly)
+	int32 x_length_ = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 y_length_ = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int64 saved_at_ = 0;//The ticks of the UTC FDateTime
+	UPROPERTY(BlueprintReadOnly)
+	TArray<EGroundType> thumbnail_;//kThumbnailLength * kThumbnailLength pixels of the ground, index = x * kThumbnailLength + y like FTileStore
+	uint32 save_id_ = 0;//Of the full save, the journal records written for it update the info. 0 if not saved
+	UPROPERTY(BlueprintReadOnly)
+	bool is_info_saved_ = false;//UMySaveGame slots and saves of the first versions have none, only the name and the time are known
+};
+
+/**
+ * The tags of the sections. Never reuse a tag, add a new one instead.
+ */
+enum class ESaveSection : uint32
+{
+	End = 0,
+	Time = 1,
+	Weather = 2,
+	Map = 3,
+	Ground = 4,//Bit-packed ground types
+	Items = 5,//Sparse item records
+	Player = 6,
+	SaveId = 7,//The id of a full save, the journal records after it carry it
+	Tiles = 8,//Whole blocks, only in journal records
+	Temperature = 9,//Run-length encoded delta temperature
+	Focus = 10,//The chunk the player is in
+	ChunkIndex = 11//The sizes of the chunks behind the sections
+};
+
+/**
+ * The uncompressed header at the front of a save.
+ */
+struct FSaveHeader
+{
+	uint32 magic_ = 0;
+	uint16 version_ = 0;
+	uint16 header_size_ = 0;//Bytes of the header and the slot info, the sections begin after it
+	uint8 compression_ = 0;//0 none, 1 zlib, 2 lz4
+	uint32 body_size_ = 0;//Bytes of the sections before compression
+	uint32 stored_size_ = 0;//Bytes of the sections in the file
+	uint32 body_crc_ = 0;//Crc of the sections before compression
+};
+
+class STARDEWVALLEY_API FSaveFormat
+{
+public:
+	/**
+	 * \brief Encode a snapshot in the current version. Touches no UObject, so it can run on any thread.
+	 *
+	 * \param snapshot The data to save
+	 * \param data Return value. The bytes of the save
+	 * \return true if encoded
+	 */
+	static bool Write(const FSaveSnapshot& snapshot, TArray<uint8>& data);
+	/**
+	 * \brief Decode a save of any version up to the current one.
+	 *
+	 * \param data The bytes of the save
+	 * \param snapshot Return value. The saved data
+	 * \return false if the bytes are not a save, are damaged or are from a newer version
+	 */
+	static bool Read(const TArray<uint8>& data, FSaveSnapshot& snapshot);
+	/**
+	 * \brief Decode a save without its chunks. The layers of a save with chunks are left empty, see ReadChunk.
+	 *
+	 * \param data The bytes of the save, e.g. a mapped file
+	 * \param size The number of bytes
+	 * \param snapshot Return value. The saved data and the chunk index
+	 * \return false if the bytes are not a save, are damaged or are from a newer version
+	 */
+	static bool ReadMap(const uint8* data, int64 size, FSaveSnapshot& snapshot);
+	/**
+	 * \brief Decode one chunk. Touches no UObject and only reads the bytes, so chunks can be decoded on several threads at once.
+	 *
+	 * \param data The bytes of the save
+	 * \param size The number of bytes
+	 * \param snapshot The snapshot ReadMap has returned, for the size of the map and the chunk index
+	 * \param chunk The index of the chunk in the chunk index
+	 * \param blocks Return value. The blocks of the chunk, sized to the chunk
+	 * \param x_begin Return value. The x of the first block of the chunk on the map
+	 * \param y_begin Return value. The y of the first block of the chunk on the map
+	 * \return false if the chunk is damaged
+	 */
+	static bool ReadChunk(const uint8* data, int64 size, const FSaveSnapshot& snapshot, int32 chunk, FSaveSnapshot& blocks, int32& x_begin, int32& y_begin);
+	/**
+	 * \brief Check the magic number, to tell this format from the old UMySaveGame slots.
+	 */
+	static bool IsSaveData(const TArray<uint8>& data);
+	static bool IsSaveData(const uint8* data, int64 size);
+	/**
+	 * \brief Convert an old UMySaveGame, which is version 0 of the format.
+	 *
+	 * \param legacy The loaded UMySaveGame
+	 * \param snapshot Return value. The saved data
+	 */
+	static void ReadLegacy(const UMySaveGame* legacy, FSaveSnapshot& snapshot);
+	/**
+	 * \brief Encode a delta as a record of the journal. The records are appended to the journal file one after another.
+	 *
+	 * \param delta The changes to save
+	 * \param record Return value. The bytes of the record
+	 */
+	static void WriteJournalRecord(const FSaveDelta& delta, TArray<uint8>& record);
+	/**
+	 * \brief Apply the records of a journal that follow the full save read into the snapshot, in order.
+	 * \brief Reading stops at the first damaged record, e.g. one cut off by a crash.
+	 *
+	 * \param journal The bytes of the journal file
+	 * \param snapshot The full save, updated in place
+	 * \param is_complete Return value. false if reading stopped before the end, the records appended after it would never be read
+	 * \return The number of records applied
+	 */
+	static int32 ReadJournal(const TArray<uint8>& journal, FSaveSnapshot& snapshot, bool& is_complete);
+	/**
+	 * \brief Read the slot info of a save without its sections. Only the front of the save is read, so the archive may be a file reader.
+	 *
+	 * \param archive The save, at its start
+	 * \param info Return value. is_info_saved_ is false if the save has no slot info
+	 * \return false if the archive is not a save
+	 */
+	static bool ReadSlotInfo(FArchive& archive, FSaveSlotInfo& info);
+	/**
+	 * \brief Bring the slot info up to the autosaves in the journal of the save. The thumbnail stays the one of the full save.
+	 *
+	 * \param journal The bytes of the journal file
+	 * \param info The slot info read from the save, updated in place
+	 * \return The number of records read, 0 if none follow the save
+	 */
+	static int32 ReadJournalSlotInfo(const TArray<uint8>& journal, FSaveSlotInfo& info);
+
+	static constexpr uint32 kMagic = 0x47535653;//"SVSG"
+	static constexpr uint32 kJournalMagic = 0x4A535653;//"SVSJ"
+	static constexpr uint16 kCurrentVersion = 3;
+	static constexpr int32 kThumbnailLength = 32;
+	static constexpr int32 kChunkLength = 16;//Blocks on a side of a chunk when written
+private:
+	static bool ReadHeader(FArchive& archive, FSaveHeader& header);
+	/**
+	 * \brief Fill the slot info from a snapshot. The thumbnail samples the ground at even steps.
+	 */
+	static void MakeSlotInfo(const FSaveSnapshot& snapshot, FSaveSlotInfo& info);
+	static void WriteSlotInfo(FArchive& archive, const FSaveSlotInfo& info);
+	static void ReadSlotInfoFields(FArchive& archive, FSaveSlotInfo& info);
+	static void WriteSections(FArchive& archive, const FSaveSnapshot& snapshot, const FSaveChunkIndex& chunk_index);
+	/**
+	 * \brief Encode the blocks of a chunk as Ground, Temperature and Items sections of their own.
+	 */
+	static void WriteChunk(const FSaveSnapshot& snapshot, int32 chunk_x, int32 chunk_y, TArray<uint8>& stored, FSaveChunkIndex::FEntry& entry);
+	/**
+	 * \brief Compress with kCompression, or keep the bytes as they are if that is not smaller.
+	 *
+	 * \return The compression used
+	 */
+	static uint8 Compress(const TArray<uint8>& body, TArray<uint8>& stored);
+	static bool Uncompress(uint8 compression, const uint8* stored, int64 stored_size, TArray<uint8>& body);
+	/**
+	 * \brief Read sections into the snapshot. Only the data of the sections read is replaced, so a journal record is read over a full save.
+	 * \brief A section whose layout changed reads by the version, there is no step after reading:
+	 * \brief 0 is UMySaveGame, see ReadLegacy. 1 has no temperature in the tiles, is_temperature_saved_ stays false and the fires warm the ground again.
+	 * \brief 2 has the blocks in whole-map sections instead of chunks, its chunk index is empty.
+	 */
+	static bool ReadSections(FArchive& archive, int32 version, FSaveSnapshot& snapshot);
+	static void WriteTime(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void WriteWeather(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void WritePlayer(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void WriteFocus(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void ReadChunkIndex(FArchive& archive, FSaveSnapshot& snapshot);
+	static void WriteGround(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void ReadGround(FArchive& archive, FSaveSnapshot& snapshot);
+	static void WriteItems(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void ReadItems(FArchive& archive, FSaveSnapshot& snapshot);
+	static void WriteTemperature(FArchive& archive, const FSaveSnapshot& snapshot);
+	static void ReadTemperature(FArchive& archive, FSaveSnapshot& snapshot);
+	static void WriteTiles(FArchive& archive, const TArray<FSaveTile>& tiles);
+	static void ReadTiles(FArchive& archive, int32 version, FSaveSnapshot& snapshot);
+	static FName CompressionToName(uint8 compression);
+
+	static constexpr uint8 kCompression = 1;//Zlib, the best size for the layers
+	static constexpr int32 kMaxLength = 4096;//Larger maps are taken as damage
+};
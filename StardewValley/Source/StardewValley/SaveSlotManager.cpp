@@ -0,0 +1,160 @@
+/*****************************************************************//**
+ * \file   SaveSlotManager.cpp
+ * \brief  The implementation of the save slot manager
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+
+#include "SaveSlotManager.h"
+#include "Engine/Texture2D.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+constexpr const TCHAR* USaveSlotManager::kDefaultSlotName;
+
+namespace
+{
+	const uint32 kSaveGameFileTag = 0x53415647;//"GVAS", the front of a file UGameplayStatics::SaveGameToSlot writes
+}
+
+void USaveSlotManager::GetSlots(TArray<FSaveSlotInfo>& slots)
+{
+	double start_time = FPlatformTime::Seconds();
+	TArray<FString> files;
+	IFileManager::Get().FindFiles(files, *(GetSaveDirectory() / TEXT("*.sav")), true, false);//Any name SelectSlot was given
+
+	TSet<FString> slot_names;
+	int32 read_count = 0;
+	slots.Reset(files.Num());
+	for (const FString& file : files)
+	{
+		FString slot_name = FPaths::GetBaseFilename(file);
+		slot_names.Add(slot_name);
+		FDateTime file_time = IFileManager::Get().GetTimeStamp(*GetSavePath(slot_name));
+		FDateTime journal_time = IFileManager::Get().GetTimeStamp(*GetJournalPath(slot_name));
+		FCachedSlot* cached = cache_.Find(slot_name);
+		if (cached == nullptr || cached->file_time_ != file_time || cached->journal_time_ != journal_time)
+		{
+			//New or saved again since it was read
+			FCachedSlot slot;
+			slot.file_time_ = file_time;
+			slot.journal_time_ = journal_time;
+			if (!ReadSlotInfo(slot_name, slot.info_))continue;//Not a save of this game
+			if (!slot.info_.is_info_saved_)slot.info_.saved_at_ = file_time.GetTicks();
+			cached = &cache_.Add(slot_name, MoveTemp(slot));
+			read_count++;
+		}
+		slots.Add(cached->info_);
+	}
+	for (auto it = cache_.CreateIterator(); it; ++it)
+	{
+		if (!slot_names.Contains(it.Key()))it.RemoveCurrent();
+	}
+	slots.Sort([](const FSaveSlotInfo& a, const FSaveSlotInfo& b) { return a.saved_at_ > b.saved_at_; });
+	UE_LOG(LogTemp, Log, TEXT("SaveSlotManager.cpp: GetSlots: %d slots, %d read, in %.2f ms"), slots.Num(), read_count, (FPlatformTime::Seconds() - start_time) * 1000.0);
+}
+
+FString USaveSlotManager::GetLatestSlotName()
+{
+	TArray<FSaveSlotInfo> slots;
+	GetSlots(slots);
+	return slots.Num() > 0 ? slots[0].slot_name_ : FString(kDefaultSlotName);
+}
+
+FString USaveSlotManager::MakeNewSlotName()
+{
+	FString slot_name = kDefaultSlotName;
+	for (int32 i = 1; IFileManager::Get().FileExists(*GetSavePath(slot_name)); i++)
+	{
+		slot_name = FString::Printf(TEXT("%s%d"), kDefaultSlotName, i);
+	}
+	return slot_name;
+}
+
+bool USaveSlotManager::DeleteSlot(const FString& slot_name)
+{
+	cache_.Remove(slot_name);
+	IFileManager::Get().Delete(*GetJournalPath(slot_name), false, false, true);
+	FString save_path = GetSavePath(slot_name);
+	if (!IFileManager::Get().FileExists(*save_path))return true;
+	bool is_deleted = IFileManager::Get().Delete(*save_path);
+	UE_LOG(LogTemp, Warning, TEXT("Delete %s : %d"), *save_path, is_deleted);
+	return is_deleted;
+}
+
+UTexture2D* USaveSlotManager::CreateThumbnailTexture(const FSaveSlotInfo& info)
+{
+	const int32 length = FSaveFormat::kThumbnailLength;
+	if (!info.is_info_saved_ || info.thumbnail_.Num() != length * length)return nullptr;
+
+	//In the order of EGroundType
+	static const FColor kGroundColors[] = {
+		FColor(0, 0, 0, 0),
+		FColor(96, 160, 64),
+		FColor(150, 110, 70),
+		FColor(110, 75, 45),
+		FColor(235, 240, 245),
+		FColor(60, 120, 200)
+	};
+	static_assert(UE_ARRAY_COUNT(kGroundColors) == static_cast<int32>(EGroundType::Count), "A color for each ground type");
+
+	UTexture2D* texture = UTexture2D::CreateTransient(length, length, PF_B8G8R8A8);
+	if (texture == nullptr)return nullptr;
+	texture->Filter = TF_Nearest;
+	FColor* pixels = static_cast<FColor*>(texture->PlatformData->Mips[0].BulkData.Lock(LOCK_READ_WRITE));
+	for (int32 x = 0; x < length; x++)
+	{
+		for (int32 y = 0; y < length; y++)
+		{
+			//The map x goes right and y goes down in the texture
+			pixels[y * length + x] = kGroundColors[static_cast<int32>(info.thumbnail_[x * length + y])];
+		}
+	}
+	texture->PlatformData->Mips[0].BulkData.Unlock();
+	texture->UpdateResource();
+	return texture;
+}
+
+FString USaveSlotManager::GetSaveDirectory()
+{
+	//Where the save game system of the desktop platforms writes the slots
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames");
+}
+
+FString USaveSlotManager::GetSavePath(const FString& slot_name)
+{
+	return GetSaveDirectory() / slot_name + TEXT(".sav");
+}
+
+FString USaveSlotManager::GetJournalPath(const FString& slot_name)
+{
+	return GetSaveDirectory() / slot_name + TEXT(".journal");
+}
+
+bool USaveSlotManager::ReadSlotInfo(const FString& slot_name, FSaveSlotInfo& info)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*GetSavePath(slot_name), FILEREAD_Silent));
+	if (Reader == nullptr)return false;
+	info = FSaveSlotInfo();
+	info.slot_name_ = slot_name;
+	if (!FSaveFormat::ReadSlotInfo(*Reader, info))
+	{
+		//A UMySaveGame slot is listed too, by its name and time
+		uint32 tag = 0;
+		Reader->Seek(0);
+		*Reader << tag;
+		return !Reader->IsError() && tag == kSaveGameFileTag;
+	}
+	Reader.Reset();
+
+	//The autosaves since the full save are in the journal, so is the time of the last one
+	TArray<uint8> journal;
+	FString journal_path = GetJournalPath(slot_name);
+	if (FFileHelper::LoadFileToArray(journal, *journal_path, FILEREAD_Silent) && FSaveFormat::ReadJournalSlotInfo(journal, info) > 0)
+	{
+		info.saved_at_ = FMath::Max(info.saved_at_, IFileManager::Get().GetTimeStamp(*journal_path).GetTicks());
+	}
+	return true;
+}
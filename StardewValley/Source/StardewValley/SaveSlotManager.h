@@ -0,0 +1,84 @@
+/*****************************************************************
+ * \file   SaveSlotManager.h
+ * \brief  The save slots. A slot is a save file in the SaveGames folder, of any name, and its journal.
+ * \brief  The slot list reads only the slot info at the front of each file, and is cached by the time of the file.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "SaveFormat.h"
+#include "SaveSlotManager.generated.h"
+
+class UTexture2D;
+
+/**
+ *
+ */
+UCLASS()
+class STARDEWVALLEY_API USaveSlotManager : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	/**
+	 * \brief Get the info of every slot, the latest saved first. Only the files changed since the last call are read.
+	 *
+	 * \param slots Return value. The info of the slots
+	 */
+	UFUNCTION(BlueprintCallable)
+	void GetSlots(TArray<FSaveSlotInfo>& slots);
+	/**
+	 * \brief Get the slot saved or autosaved last, for continue.
+	 *
+	 * \return The name of the slot, kDefaultSlotName if there is no slot
+	 */
+	UFUNCTION(BlueprintCallable)
+	FString GetLatestSlotName();
+	/**
+	 * \brief Get a name no slot has yet, for a new game. Give it to UDataSystem::SelectSlot.
+	 */
+	UFUNCTION(BlueprintCallable)
+	FString MakeNewSlotName();
+	/**
+	 * \brief Delete the save and the journal of a slot. The data system must not be writing to it.
+	 *
+	 * \param slot_name The name of the slot
+	 * \return true if the slot is gone
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool DeleteSlot(const FString& slot_name);
+	/**
+	 * \brief Make a texture of the thumbnail, one color per ground type.
+	 *
+	 * \param info The slot info
+	 * \return The texture, nullptr if the slot has no thumbnail
+	 */
+	UFUNCTION(BlueprintCallable)
+	UTexture2D* CreateThumbnailTexture(const FSaveSlotInfo& info);
+
+	static FString GetSaveDirectory();
+	static FString GetSavePath(const FString& slot_name);
+	static FString GetJournalPath(const FString& slot_name);
+
+	static constexpr const TCHAR* kDefaultSlotName = TEXT("SavedGame");//The only slot before there were slots
+private:
+	/**
+	 * \brief Read the slot info of a file, brought up to the autosaves in its journal.
+	 *
+	 * \param slot_name The name of the slot
+	 * \param info Return value. The slot info
+	 * \return false if the file can not be opened or is neither a save nor a UMySaveGame slot
+	 */
+	bool ReadSlotInfo(const FString& slot_name, FSaveSlotInfo& info);
+
+	struct FCachedSlot
+	{
+		FDateTime file_time_;
+		FDateTime journal_time_;//FDateTime::MinValue if there is no journal
+		FSaveSlotInfo info_;
+	};
+	TMap<FString, FCachedSlot> cache_;//Slot name -> info read
+};
@@ -7,151 +7,319 @@
  *********************************************************************/
 
 #include "SceneManager.h"
-#include "GrassGround.h"
+#include "GroundRenderer.h"
 #include "DataSystem.h"
 #include "EventSystem.h"
 #include <stdexcept>
 #include "ItemBlockBase.h"
-#include "Engine/DataTable.h"
-#include "Struct_ItemBlockBase.h"
+#include "ItemRegistry.h"
+#include "CropSystem.h"
 #include "UserInterface.h"
-#include <random>
-#include <ctime>
-
+#include "MapGenerator.h"
+#include "LoadingWidget.h"
+#include "TimeSystem.h"
+#include "AssetCatalog.h"
+#include "CharacterManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+
+static TAutoConsoleVariable<int32> CVarMapSeed(
+	TEXT("sv.MapSeed"),
+	0,
+	TEXT("The seed of the next new map, the same seed gives the same map. 0 picks a random seed."));
+static TAutoConsoleVariable<int32> CVarMapSize(
+	TEXT("sv.MapSize"),
+	128,
+	TEXT("The number of blocks along each side of the next new map."));
+static TAutoConsoleVariable<float> CVarWorldBuildBudget(
+	TEXT("sv.WorldBuildBudget"),
+	4.0f,
+	TEXT("The milliseconds of a frame spent on building the world and loading chunks."));
 
 void USceneManager::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
 
-	srand(time(nullptr));
 	is_menu_exist = false;
+	//The world is built by Tick once it is ready
+	world_build_stage_ = EWorldBuildStage::WaitingForWorld;
+	world_build_start_time_ = 0.0;
+	is_registering_items_ = false;
+	is_fire_applied_ = false;
+	item_register_minute_ = 0;
+	pending_chunk_tile_ = 0;
+	initial_chunk_count_ = 0;
+	player_chunk_ = FIntPoint(0, 0);
+	loading_widget_ = nullptr;
+	ground_swap_cursor_ = 0;
+	ground_transition_time_ = -1.0f;
+	season_parameters_ = LoadObject<UMaterialParameterCollection>(nullptr, TEXT("/Game/Material/MPC_Season.MPC_Season"), nullptr, LOAD_NoWarn | LOAD_Quiet);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->Subscribe(EventSystem->OnWinterBegin, TEXT("OnWinterBegin"), this, &USceneManager::ChangeEarthGroundToSnowGround);
+	EventSystem->Subscribe(EventSystem->OnSpringBegin, TEXT("OnSpringBegin"), this, &USceneManager::ChangeSnowGroundToEarthGround);
+	EventSystem->Subscribe(EventSystem->OnItemBlockAttacked, TEXT("OnItemBlockAttacked"), this, &USceneManager::ItemBlockInteractionHandler);
+	EventSystem->Subscribe(EventSystem->OnCallingMenu, TEXT("OnCallingMenu"), this, &USceneManager::InvokeUIMenu);
+	EventSystem->Subscribe(EventSystem->OnUIMenuClosed, TEXT("OnUIMenuClosed"), this, &USceneManager::SetIsMenuExistToFalse);
+	EventSystem->Subscribe(EventSystem->OnMowingGrassGround, TEXT("OnMowingGrassGround"), this, &USceneManager::ChangeGrassGroundToEarthGround);
+	EventSystem->Subscribe(EventSystem->OnPloughingEarthGround, TEXT("OnPloughingEarthGround"), this, &USceneManager::ChangeEarthGroundToFieldGround);
+	EventSystem->Subscribe(EventSystem->OnPlayerChunkChanged, TEXT("OnPlayerChunkChanged"), this, &USceneManager::UpdateLoadedChunks);
+}
+
+void USceneManager::Deinitialize()
+{
+	Super::Deinitialize();
+
+	pending_chunks_.Empty();
+	water_crop_subscriptions_.Empty();
+	ground_swap_queue_.Empty();
+	is_registering_items_ = false;
+	world_build_stage_ = EWorldBuildStage::Ready;
+}
+
+/*----------------------------------------------World Building-------------------------------------*/
+void USceneManager::Tick(float DeltaTime)
+{
+	const double deadline = FPlatformTime::Seconds() + CVarWorldBuildBudget.GetValueOnGameThread() / 1000.0;
+	switch (world_build_stage_)
+	{
+	case EWorldBuildStage::WaitingForWorld:
+		if (loading_widget_ == nullptr && GetWorld() != nullptr && GetWorld()->GetFirstPlayerController() != nullptr)ShowLoadingWidget();
+		if (!IsWorldReadyToBuild())break;
+		world_build_start_time_ = FPlatformTime::Seconds();
+		world_build_stage_ = EWorldBuildStage::GeneratingMap;
+		GetGameInstance()->GetSubsystem<UTimeSystem>()->PauseTime();//The clock starts when the world is ready
+		GenerateMap();
+		break;
+	case EWorldBuildStage::GeneratingMap:
+		break;//SpawnGroundRenderer moves on when the map is ready
+	case EWorldBuildStage::RegisteringItems:
+		GenerateSpawnItems();
+		world_build_stage_ = EWorldBuildStage::SpawningCharacter;
+		break;
+	case EWorldBuildStage::SpawningCharacter:
+	{
+		//The character queues the chunks around it as it begins play
+		world_build_stage_ = EWorldBuildStage::LoadingChunks;
+		UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+		EventSystem->BroadcastEvent(EventSystem->OnGroundGenerated);
+		initial_chunk_count_ = pending_chunks_.Num();
+		break;
+	}
+	case EWorldBuildStage::LoadingChunks:
+		LoadPendingChunks(deadline);
+		if (pending_chunks_.Num() == 0)FinishWorldBuild();
+		break;
+	case EWorldBuildStage::Ready:
+		LoadPendingChunks(deadline);
+		//The items of the chunks the worker has decoded, the crops catch up with the minutes since the world was built
+		if (is_registering_items_)is_registering_items_ = !GenerateItems(deadline);
+		break;
+	}
+	UpdateGroundTransition(DeltaTime, deadline);
+
+	if (loading_widget_ != nullptr)
+	{
+		static const FText kStageTexts[] = {
+			FText::FromString(TEXT("Waiting for the world")),
+			FText::FromString(TEXT("Generating the map")),
+			FText::FromString(TEXT("Placing the items")),
+			FText::FromString(TEXT("Spawning the character")),
+			FText::FromString(TEXT("Loading the ground")),
+			FText::FromString(TEXT("Ready")) };
+		loading_widget_->SetProgress(get_world_build_progress(), kStageTexts[static_cast<int32>(world_build_stage_)]);
+	}
+}
+
+ETickableTickType USceneManager::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* USceneManager::GetTickableGameObjectWorld() const
+{
+	return GetGameInstance() ? GetGameInstance()->GetWorld() : nullptr;
+}
+
+TStatId USceneManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USceneManager, STATGROUP_Tickables);
+}
+
+float USceneManager::get_world_build_progress() const
+{
+	switch (world_build_stage_)
+	{
+	case EWorldBuildStage::WaitingForWorld:
+	case EWorldBuildStage::GeneratingMap:
+		return 0.0f;
+	case EWorldBuildStage::RegisteringItems:
+		return kMapProgress;
+	case EWorldBuildStage::SpawningCharacter:
+		return kMapProgress + kItemProgress;
+	case EWorldBuildStage::LoadingChunks:
+	{
+		float chunk_progress = initial_chunk_count_ > 0 ? 1.0f - static_cast<float>(pending_chunks_.Num()) / initial_chunk_count_ : 1.0f;
+		return kMapProgress + kItemProgress + (1.0f - kMapProgress - kItemProgress) * FMath::Clamp(chunk_progress, 0.0f, 1.0f);
+	}
+	default:
+		return 1.0f;
+	}
+}
+
+bool USceneManager::IsWorldReadyToBuild() const
+{
 	UWorld* World = GetWorld();
-	if (World)
+	return World != nullptr && World->HasBegunPlay() && World->GetFirstPlayerController() != nullptr
+		&& GetGameInstance()->GetSubsystem<UAssetCatalog>()->is_preloaded();
+}
+
+void USceneManager::ShowLoadingWidget()
+{
+	UClass* WidgetClass = LoadClass<ULoadingWidget>(nullptr, TEXT("/Game/UMG/WBP_Loading.WBP_Loading_C"), nullptr, LOAD_NoWarn | LOAD_Quiet);//Optional
+	if (WidgetClass == nullptr)WidgetClass = ULoadingWidget::StaticClass();//No blueprint, use the widgets built in code
+	loading_widget_ = CreateWidget<ULoadingWidget>(GetGameInstance(), WidgetClass);
+	if (loading_widget_)
 	{
-		World->GetTimerManager().SetTimer(timer_handler_, this, &USceneManager::GenerateMap, 2.0f, false);//Delay the generation of the map, otherwise the world may not be ready, and the map will not be generated
+		loading_widget_->AddToViewport(100);//Above the other widgets
 	}
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnGroundGenerated.AddUObject(this, &USceneManager::GenerateItems);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnWinterBegin.AddUObject(this, &USceneManager::ChangeEarthGroundToSnowGround);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnSpringBegin.AddUObject(this, &USceneManager::ChangeSnowGroundToEarthGround);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->WaterCropAtGivenPosition.AddUObject(this, &USceneManager::WaterCropAtLocation);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnItemBlockAttacked.AddUObject(this, &USceneManager::ItemBlockInteractionHandler);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnCallingMenu.AddUObject(this, &USceneManager::InvokeUIMenu);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnUIMenuClosed.AddUObject(this, &USceneManager::SetIsMenuExistToFalse);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnMowingGrassGround.AddUObject(this, &USceneManager::ChangeGrassGroundToEarthGround);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnPloughingEarthGround.AddUObject(this, &USceneManager::ChangeEarthGroundToFieldGround);
 }
 
-void USceneManager::Deinitialize()
+void USceneManager::FinishWorldBuild()
 {
-	Super::Deinitialize();
+	world_build_stage_ = EWorldBuildStage::Ready;
+	if (loading_widget_ != nullptr)
+	{
+		loading_widget_->RemoveFromParent();
+		loading_widget_ = nullptr;
+	}
+	GetGameInstance()->GetSubsystem<UTimeSystem>()->ResumeTime();
+	UE_LOG(LogTemp, Warning, TEXT("World built in %.2f s"), FPlatformTime::Seconds() - world_build_start_time_);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnWorldReady);
 
-	// Get the game instance and then the world
-	UGameInstance* GameInstance = GetGameInstance();
-	if (GameInstance)
+	/*----------------------------------------------TEST BLOCK------------------------------------------*/
+	InvokeUIMenu();
+	UClass* WidgetClass = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetClass(EAssetKey::ShortcutWidgetClass);
+	if (WidgetClass)
 	{
-		UWorld* World = GameInstance->GetWorld();
-		if (World)
+		UUserWidget* Widget = CreateWidget<UUserWidget>(GetGameInstance(), WidgetClass);
+
+		if (Widget)
 		{
-			// Clear the timer
-			World->GetTimerManager().ClearTimer(timer_handler_);
+			Widget->AddToViewport();
 		}
 	}
+	/*----------------------------------------------TEST BLOCK------------------------------------------*/
 }
 
 void USceneManager::GenerateMap()
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	if (DataSystem->is_items_initialized())
+	{
+		SpawnGroundRenderer();
+		return;
+	}
+	if (map_generation_task_.IsValid() && !map_generation_task_->IsComplete())return;//Already generating
+
+	//A new map, generated off the game thread
+	FMapGenerationSettings settings;
+	settings.seed_ = CVarMapSeed.GetValueOnGameThread();
+	if (settings.seed_ == 0)settings.seed_ = static_cast<int32>(FPlatformTime::Cycles() | 1);
+	settings.x_length_ = FMath::Clamp(CVarMapSize.GetValueOnGameThread(), settings.farm_size_.X + 16, kMaxLength);
+	settings.y_length_ = settings.x_length_;
+	UE_LOG(LogTemp, Warning, TEXT("Generating a %d x %d map with seed %d"), settings.x_length_, settings.y_length_, settings.seed_);
+
+	TWeakObjectPtr<USceneManager> WeakThis(this);
+	map_generation_task_ = FMapGenerator::GenerateAsync(settings, [WeakThis](FGeneratedMap& map)
+		{
+			if (WeakThis.IsValid())WeakThis->ApplyGeneratedMap(map);
+		});
+}
+void USceneManager::ApplyGeneratedMap(FGeneratedMap& map)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	if (DataSystem->is_items_initialized())return;//A map has been loaded meanwhile
+
+	DataSystem->set_ground_block_lengths(map.x_length_, map.y_length_);
+	DataSystem->set_ground_block_size(kDefaultBlockSize);
+	DataSystem->set_map_seed(map.seed_);
+
+	//The layers are moved in, the items are registered by GenerateItems and spawned when their chunks are loaded
+	FTileStore& tiles = DataSystem->get_tiles();
+	tiles.Reset(map.x_length_, map.y_length_);
+	tiles.ground_type_ = MoveTemp(map.ground_type_);
+	tiles.item_id_ = MoveTemp(map.item_id_);
+	DataSystem->set_is_items_initialized(true);
+	DataSystem->set_is_temperature_initialized(false);//The fires, if any, warm the new ground when registered
+	DataSystem->MarkAllTilesDirty();
+
+	SpawnGroundRenderer();
+}
+void USceneManager::SpawnGroundRenderer()
 {
 	// The World context
 	UWorld* World = GetWorld();
 	FVector SpawnLocation = FVector(0.0f, 0.0f, 0.0f);
 	FRotator SpawnRotation = FRotator(0.0f, 0.0f, 0.0f);
-	// Load the blueprint class
-	UClass* GrassGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_GrassGround.BP_GrassGround_C"));
-	UClass* EarthGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_EarthGround.BP_EarthGround_C"));
-	UClass* FieldGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_FieldGround.BP_FieldGround_C"));
-	UClass* SnowGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_SnowGround.BP_SnowGround_C"));
-	UClass* WaterGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_WaterGround.BP_WaterGround_C"));
-	TArray<UClass*> GroundClasses = { GrassGroundClass, EarthGroundClass, FieldGroundClass, SnowGroundClass, WaterGroundClass };
+	// The blueprint classes
+	UAssetCatalog* AssetCatalog = GetGameInstance()->GetSubsystem<UAssetCatalog>();
+	UClass* GrassGroundClass = AssetCatalog->GetClass(EAssetKey::GrassGroundClass);
+	UClass* EarthGroundClass = AssetCatalog->GetClass(EAssetKey::EarthGroundClass);
+	UClass* FieldGroundClass = AssetCatalog->GetClass(EAssetKey::FieldGroundClass);
+	UClass* SnowGroundClass = AssetCatalog->GetClass(EAssetKey::SnowGroundClass);
+	UClass* WaterGroundClass = AssetCatalog->GetClass(EAssetKey::WaterGroundClass);
+	TArray<UClass*> GroundClasses = { nullptr, GrassGroundClass, EarthGroundClass, FieldGroundClass, SnowGroundClass, WaterGroundClass };//Indexed by EGroundType
 
 	if (GrassGroundClass)
 	{
-		int32 x_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_x_length();
-		int32 y_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_y_length();
-		int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
+		UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+		int32 x_length = DataSystem->get_ground_block_x_length();
+		int32 y_length = DataSystem->get_ground_block_y_length();
+		int32 block_size = DataSystem->get_ground_block_size();
+
+		// Prepare the ground renderer, the ground is drawn chunk by chunk around the player
+		ground_renderer_ = World->SpawnActor<AGroundRenderer>(AGroundRenderer::StaticClass(), SpawnLocation, SpawnRotation);
+		if (ground_renderer_)
+		{
+			ground_renderer_->InitializeRenderer(GroundClasses, x_length, y_length, block_size);
+		}
 
-		//If there is no ground block, create the initial map.
-		if (GetGameInstance()->GetSubsystem<UDataSystem>()->is_items_initialized() == false)
+		if (ground_renderer_)
 		{
-			x_length = kMaxLength;
-			y_length = kMaxLength;
-			block_size = kDefaultBlockSize;
-			GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_x_length(x_length);
-			GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_y_length(y_length);
-			GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_size(block_size);
-
-			for (int i = 0; i < x_length * y_length; i++)
+			UE_LOG(LogTemp, Warning, TEXT("Ground instance created successfully!"));
+			is_registering_items_ = false;
+			world_build_stage_ = EWorldBuildStage::RegisteringItems;
+
+			//Chunks loaded before the map was ready are drawn again, the map may even have been resized since
+			TArray<FIntPoint> chunks = MoveTemp(loaded_chunks_);
+			loaded_chunks_.Reset();
+			pending_chunks_.Reset();
+			UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+			for (const TPair<FIntPoint, int32>& subscription : water_crop_subscriptions_)
 			{
-				GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(i, "GrassGround");
-				GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(i, 0);
+				EventSystem->UnsubscribeTileEvent(subscription.Value);
 			}
-
-			for (int i = 0; i <= 71; i++)
-				for (int j = 99; j <= 127; j++)
-				{
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(i, j, "WaterGround");
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(i, j, 0);
-				}
-			for (int i = 32; i <= 83; i++)
-				for (int j = 43; j <= 89; j++)
-				{
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(i, j, "FieldGround");
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(i, j, 0);
-				}
-			for (int i = 29; i <= 88; i++)
-				for (int j = 29; j <= 37; j++)
-				{
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(i, j, "EarthGround");
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(i, j, 0);
-				}
-			for (int i = 89; i <= 97; i++)
-				for (int j = 29; j <= 92; j++)
-				{
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(i, j, "EarthGround");
-					GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(i, j, 0);
-				}
-		}
-		AActor* GroundInstance = nullptr;
-		// Spawn the ground
-		for (int i = 0; i < x_length; i++)
-		{
-			for (int j = 0; j < y_length; j++)
+			water_crop_subscriptions_.Reset();
+			for (const FIntPoint& chunk : chunks)
 			{
-				int32 type_index = 0;
-				FString type = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(i * x_length + j);
-				if (type == "GrassGround")type_index = 0;
-				else if (type == "EarthGround")type_index = 1;
-				else if (type == "FieldGround")type_index = 2;
-				else if (type == "SnowGround")type_index = 3;
-				else if (type == "WaterGround")type_index = 4;
-				else continue;
-				GroundInstance = World->SpawnActor<AActor>(GroundClasses[type_index], SpawnLocation + FVector(i * block_size, j * block_size, 0.0f), SpawnRotation);
-				GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block(i * x_length + j, Cast<AGroundBlockBase>(GroundInstance));
+				if (chunk.X >= DataSystem->get_chunk_x_count() || chunk.Y >= DataSystem->get_chunk_y_count())continue;
+				DataSystem->set_is_chunk_loaded(chunk.X, chunk.Y, true);
+				loaded_chunks_.Add(chunk);
+				pending_chunks_.Add(chunk);
 			}
 		}
-
-		if (GroundInstance)
-		{
-			if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnGroundGenerated.IsBound())
-				GetGameInstance()->GetSubsystem<UEventSystem>()->OnGroundGenerated.Broadcast();
-			UE_LOG(LogTemp, Warning, TEXT("Ground instance created successfully!"));
-		}
 		else
 		{
 			UE_LOG(LogTemp, Error, TEXT("Failed to create Ground instance!"));
+			FinishWorldBuild();//Do not keep the loading screen forever
 		}
 	}
 	else
 	{
 		UE_LOG(LogTemp, Error, TEXT("Failed to load BP_GrassGround class!"));
+		FinishWorldBuild();
 	}
 }
 
@@ -168,7 +336,7 @@ FString USceneManager::GetGroundBlockTypeByLocation(float x, float y)
 		UE_LOG(LogTemp, Error, TEXT("SceneManager.cpp: DestroyGroundBlockByLocation: %s"), *FString(e.what()));
 		return "";
 	}
-	return GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(index_x, index_y);
+	return GroundTypeToString(GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(index_x, index_y));
 }
 int32 USceneManager::GetGroundBlockTemperatureByLocation(float x, float y)
 {
@@ -211,85 +379,110 @@ void USceneManager::DestroyGroundBlockByLocation(float x, float y)
 		UE_LOG(LogTemp, Error, TEXT("SceneManager.cpp: DestroyGroundBlockByLocation: %s"), *FString(e.what()));
 		return;
 	}
-	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(index_x, index_y, "");
+	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(index_x, index_y, EGroundType::None);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(index_x, index_y, 0);
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block(index_x, index_y) == nullptr)return;
-	bool is_destroyed = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block(index_x, index_y)->Destroy();
-	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block(index_x, index_y, nullptr);
+	if (ground_renderer_ == nullptr)return;
+	ground_renderer_->RemoveGroundInstance(index_x, index_y);
 }
-void USceneManager::CreateGroundBlockByLocation(float x, float y, FString type)
+void USceneManager::CreateGroundBlockByLocation(float x, float y, EGroundType type)
 {
 	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
 	int32 x_index = static_cast<int32>(x / block_size);
 	int32 y_index = static_cast<int32>(y / block_size);
-	int32 x_length = kMaxLength;
-	int32 y_length = kMaxLength;
+	int32 x_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_x_length();
+	int32 y_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_y_length();
 
 	if (x < 0 || y < 0 || x_index >= x_length || y_index >= y_length)
 	{
 		throw std::out_of_range("Out of range");
 	}
 
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block(x_index, y_index) != nullptr)//There is already a ground block
+	// Add the instance if the chunk is loaded, the old one of this block is replaced
+	if (ground_renderer_ != nullptr && GetGameInstance()->GetSubsystem<UDataSystem>()->get_is_tile_loaded(x_index, y_index))
 	{
-		DestroyGroundBlockByLocation(x, y);
+		ground_renderer_->UpdateGroundInstance(x_index, y_index, static_cast<int32>(type));
 	}
 
-	// Load the blueprint class
-	UClass* GrassGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_GrassGround.BP_GrassGround_C"));
-	UClass* EarthGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_EarthGround.BP_EarthGround_C"));
-	UClass* FieldGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_FieldGround.BP_FieldGround_C"));
-	UClass* SnowGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_SnowGround.BP_SnowGround_C"));
-	UClass* WaterGroundClass = LoadObject<UClass>(nullptr, TEXT("/Game/GroundBlock/BP_WaterGround.BP_WaterGround_C"));
-	TArray<UClass*> GroundClasses = { GrassGroundClass, EarthGroundClass, FieldGroundClass, SnowGroundClass, WaterGroundClass };
-
-	// For each type of ground block
-	int type_index = 0;
-	if (type == "GrassGround")type_index = 0;
-	else if (type == "EarthGround")type_index = 1;
-	else if (type == "FieldGround")type_index = 2;
-	else if (type == "SnowGround")type_index = 3;
-	else if (type == "WaterGround")type_index = 4;
-
-	// Create the ground block
-	FVector SpawnLocation = FVector(0.0f, 0.0f, 0.0f);
-	FRotator SpawnRotation = FRotator(0.0f, 0.0f, 0.0f);
-	AActor* GroundInstance = nullptr;
-	UWorld* World = GetWorld();
-	GroundInstance = World->SpawnActor<AActor>(GroundClasses[type_index], SpawnLocation + FVector(x_index * block_size, y_index * block_size, 0.0f), SpawnRotation);
-	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block(x_index, y_index, Cast<AGroundBlockBase>(GroundInstance));
-
 	//Update data system
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_type(x_index, y_index, type);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(x_index, y_index, 0);
 }
 void USceneManager::ChangeEarthGroundToSnowGround()
 {
-	int32 x_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_x_length();
-	int32 y_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_y_length();
-	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
-	for (int i = 0; i < x_length; i++)
-		for (int j = 0; j < y_length; j++)
-		{
-			if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(i, j) == "EarthGround")
-			{
-				CreateGroundBlockByLocation(i * block_size, j * block_size, "SnowGround");
-			}
-		}
+	ReplaceGroundType(EGroundType::Earth, EGroundType::Snow);
 }
 void USceneManager::ChangeSnowGroundToEarthGround()
 {
-	int32 x_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_x_length();
-	int32 y_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_y_length();
-	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
-	for (int i = 0; i < x_length; i++)
-		for (int j = 0; j < y_length; j++)
+	ReplaceGroundType(EGroundType::Snow, EGroundType::Earth);
+}
+void USceneManager::ReplaceGroundType(EGroundType from, EGroundType to)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	DataSystem->WaitForDecode();//Every block of the map is replaced
+	FTileStore& tiles = DataSystem->get_tiles();
+	int32 queued_count = ground_swap_queue_.Num();
+	tiles.ForEachTile([&](int32 x, int32 y, int32 index)
 		{
-			if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(i, j) == "SnowGround")
+			EGroundType& type = FTileStore::At(tiles.ground_type_, index);
+			if (type != from)return;
+			type = to;
+			DataSystem->MarkTileDirty(index);
+			if (ground_renderer_ != nullptr && DataSystem->get_is_tile_loaded(x, y))
 			{
-				CreateGroundBlockByLocation(i * block_size, j * block_size, "EarthGround");
+				ground_swap_queue_.Add(index);
 			}
-		}
+		});
+	//Fade first if the materials can, the swap then does not show
+	if (season_parameters_ != nullptr && ground_swap_queue_.Num() > queued_count)ground_transition_time_ = 0.0f;
+}
+void USceneManager::UpdateGroundTransition(float DeltaTime, double deadline)
+{
+	if (ground_swap_queue_.Num() == 0)return;
+	if (ground_transition_time_ >= 0.0f)
+	{
+		ground_transition_time_ += DeltaTime;
+		SetGroundTransition(FMath::Min(ground_transition_time_ / kGroundTransitionDuration, 1.0f));
+		if (ground_transition_time_ < kGroundTransitionDuration)return;
+		ground_transition_time_ = -1.0f;
+	}
+	if (ground_renderer_ == nullptr)
+	{
+		ground_swap_queue_.Reset();
+		ground_swap_cursor_ = 0;
+		return;
+	}
+
+	//The type is read from the data when drawn, so changes since the tile was queued are drawn too
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	int32 y_length = tiles.get_y_length();
+	ground_renderer_->BeginBatchUpdate();
+	for (; ground_swap_cursor_ < ground_swap_queue_.Num(); ground_swap_cursor_++)
+	{
+		if (ground_swap_cursor_ % 64 == 0 && FPlatformTime::Seconds() >= deadline)break;//Checked every 64 tiles
+		int32 index = ground_swap_queue_[ground_swap_cursor_];
+		if (!tiles.IsValidIndex(index))continue;
+		int32 x = index / y_length;
+		int32 y = index % y_length;
+		if (!DataSystem->get_is_tile_loaded(x, y))continue;//Released, it is drawn from the data when loaded again
+		EGroundType type = FTileStore::At(tiles.ground_type_, index);
+		if (type == EGroundType::None)continue;
+		ground_renderer_->UpdateGroundInstance(x, y, static_cast<int32>(type));
+	}
+	ground_renderer_->EndBatchUpdate();
+
+	if (ground_swap_cursor_ >= ground_swap_queue_.Num())
+	{
+		ground_swap_queue_.Reset();
+		ground_swap_cursor_ = 0;
+		SetGroundTransition(0.0f);
+	}
+}
+void USceneManager::SetGroundTransition(float alpha)
+{
+	if (season_parameters_ == nullptr || GetWorld() == nullptr)return;
+	UMaterialParameterCollectionInstance* parameters = GetWorld()->GetParameterCollectionInstance(season_parameters_);
+	if (parameters != nullptr)parameters->SetScalarParameterValue(TEXT("GroundTransition"), alpha);
 }
 void USceneManager::ChangeEarthGroundToFieldGround(float x, float y)
 {
@@ -297,11 +490,12 @@ void USceneManager::ChangeEarthGroundToFieldGround(float x, float y)
 	int32 x_index;
 	int32 y_index;
 	GetIndexOfTheGroundBlockByLocation(x, y, x_index, y_index);
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block(x_index, y_index) != nullptr)return;
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(x_index, y_index) == "EarthGround")
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(x_index, y_index) != -1)return;
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(x_index, y_index) == EGroundType::Earth)
 	{
-		CreateGroundBlockByLocation(x_index * block_size, y_index * block_size, "FieldGround");
-		GetGameInstance()->GetSubsystem<UEventSystem>()->OnEarthGroundPloughed.Broadcast();
+		CreateGroundBlockByLocation(x_index * block_size, y_index * block_size, EGroundType::Field);
+		UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+		EventSystem->BroadcastEvent(EventSystem->OnEarthGroundPloughed);
 	}
 }
 void USceneManager::ChangeGrassGroundToEarthGround(float x, float y)
@@ -310,31 +504,54 @@ void USceneManager::ChangeGrassGroundToEarthGround(float x, float y)
 	int32 x_index;
 	int32 y_index;
 	GetIndexOfTheGroundBlockByLocation(x, y, x_index, y_index);
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block(x_index, y_index) != nullptr)return;
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(x_index, y_index) == "GrassGround")
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(x_index, y_index) != -1)return;
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_type(x_index, y_index) == EGroundType::Grass)
 	{
-		CreateGroundBlockByLocation(x_index * block_size, y_index * block_size, "EarthGround");
-		GetGameInstance()->GetSubsystem<UEventSystem>()->OnGrassGroundMowed.Broadcast();
+		CreateGroundBlockByLocation(x_index * block_size, y_index * block_size, EGroundType::Earth);
+		UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+		EventSystem->BroadcastEvent(EventSystem->OnGrassGroundMowed);
 	}
 }
 /*-----------------------------------------------Item Block-----------------------------------------*/
 void USceneManager::CreateItemBlockByLocation(float x, float y, int32 id)
 {
 	if (id == -1)return;
-	UClass* item_class = nullptr;
 
-	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
 	int32 x_index;
 	int32 y_index;
 	GetIndexOfTheGroundBlockByLocation(x, y, x_index, y_index);
 
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block(x_index, y_index) != nullptr)//There is already an item block
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(x_index, y_index) != -1)//There is already an item block
 	{
 		//DestroyItemBlockByLocation(x, y);
 		return;
 	}
 
-	// Create the item block
+	//Update data system
+	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block_id(x_index, y_index, id);
+	const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(id);
+	if (item_info != nullptr && item_info->is_fire())//Fire
+	{
+		ApplyFireTemperature(x_index, y_index, 20);
+	}
+	if (item_info != nullptr && item_info->is_crop())
+	{
+		GetGameInstance()->GetSubsystem<UCropSystem>()->AddCrop(x_index, y_index);
+	}
+
+	// Create the item block, only when its chunk is loaded
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_is_tile_loaded(x_index, y_index))
+	{
+		SpawnItemBlock(x_index, y_index);
+	}
+}
+void USceneManager::SpawnItemBlock(int32 x_index, int32 y_index)
+{
+	int32 id = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(x_index, y_index);
+	if (id == -1)return;
+	if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block(x_index, y_index) != nullptr)return;//Already spawned
+
+	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
 	FVector SpawnLocation = FVector(0.0f, 0.0f, kHeight);
 	FRotator SpawnRotation = FRotator(0.0f, 0.0f, 0.0f);
 	UWorld* World = GetWorld();
@@ -343,9 +560,21 @@ void USceneManager::CreateItemBlockByLocation(float x, float y, int32 id)
 	ItemInstance->InitializeItemBlock(id);
 
 	//Update data system
-	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block_id(x_index, y_index, id);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block(x_index, y_index, ItemInstance);
 }
+void USceneManager::ApplyFireTemperature(int32 x_index, int32 y_index, int32 delta_temperature)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	tiles.ForEachTileInRect(x_index - 5, y_index - 5, x_index + 5, y_index + 5, [&tiles, DataSystem, delta_temperature](int32 x, int32 y, int32 index)
+		{
+			if (FTileStore::At(tiles.ground_type_, index) != EGroundType::None)//There is a ground block.
+			{
+				FTileStore::At(tiles.delta_temperature_, index) += delta_temperature;
+				DataSystem->MarkTileDirty(index);
+			}
+		});
+}
 void USceneManager::DestroyItemBlockByLocation(float x, float y)
 {
 	int32 index_x, index_y;
@@ -359,138 +588,137 @@ void USceneManager::DestroyItemBlockByLocation(float x, float y)
 		return;
 	}
 
-	UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBlockBase.DT_ItemBlockBase"));
-	FStruct_ItemBlockBase* item_info = item_data_table->FindRow<FStruct_ItemBlockBase>(FName(*FString::FromInt(GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(index_x, index_y))), "");
+	int32 item_id = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(index_x, index_y);
+	if (item_id == -1)return;
+	const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(item_id);
 
 	//Update data system
+	GetGameInstance()->GetSubsystem<UCropSystem>()->RemoveCrop(index_x, index_y);
 	AItemBlockBase* item_block = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block(index_x, index_y);
-	if (item_block == nullptr)return;
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block_id(index_x, index_y, -1);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block_lived_time(index_x, index_y, -1);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block_durability(index_x, index_y, -1);
+	GetGameInstance()->GetSubsystem<UDataSystem>()->set_is_item_block_watered(index_x, index_y, false);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block(index_x, index_y, nullptr);
 	if (item_info != nullptr)
 	{
-		if (item_info->type_ == 4)//Fire
+		if (item_info->is_fire())//Fire
 		{
-			for (int32 i = -5; i <= 5; i++)
-				for (int32 j = -5; j <= 5; j++)
-				{
-					if (GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block(index_x + i, index_y + j) != nullptr)
-					{
-						int32 new_delta_temperature = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_delta_temperature(index_x + i, index_y + j) - 20;
-						GetGameInstance()->GetSubsystem<UDataSystem>()->set_ground_block_delta_temperature(index_x + i, index_y + j, new_delta_temperature);
-					}
-				}
+			ApplyFireTemperature(index_x, index_y, -20);
 		}
 	}
 
-	//Destroy
+	//Destroy, the chunk of the item block may be released
+	if (item_block == nullptr)return;
 	bool is_destroyed = item_block->Destroy();
 }
-void USceneManager::GenerateItems()
+void USceneManager::GenerateSpawnItems()
 {
-	int32 block_size = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_size();
-	if (GetGameInstance()->GetSubsystem<UDataSystem>()->is_items_initialized())
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	UCropSystem* CropSystem = GetGameInstance()->GetSubsystem<UCropSystem>();
+	FTileStore& tiles = DataSystem->get_tiles();
+	CropSystem->ResetCrops();
+	item_register_minute_ = CropSystem->get_present_minute();
+	//The temperature is saved, only older saves and new maps need the fires to warm the ground
+	is_fire_applied_ = !DataSystem->is_temperature_initialized();
+	if (is_fire_applied_)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Items are already initialized"));
-		for (int i = 0; i < kMaxLength; i++)
-			for (int j = 0; j < kMaxLength; j++)
-			{
-				CreateItemBlockByLocation(i * block_size + block_size / 2, j * block_size + block_size / 2, GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(i, j));
-			}
+		DataSystem->WaitForDecode();//A fire warms the blocks around it, in the chunks next to its own too
+		FTileStore::Fill(tiles.delta_temperature_, 0);//Warmed from nothing, even if registering starts over
 	}
-	else
-	{
-		int32 x_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_x_length();
-		int32 y_length = GetGameInstance()->GetSubsystem<UDataSystem>()->get_ground_block_y_length();
-		for (int i = 1; i <= 25; i++)
-			for (int j = 40; j <= 98; j++)
-			{
-				CreateItemBlockByLocation(i * block_size + block_size / 2, j * block_size + block_size / 2, 2);
-			}
-		for (int i = 26; i < x_length - 1; i++)
-			for (int j = 1; j <= 10; j++)
-			{
-				int id = rand() % 14 + 1;
-				if (id != 5 && id != 6 && id != 12 && id != 13 && id != 14)id = 6;
-				CreateItemBlockByLocation(i * block_size + block_size / 2, j * block_size + block_size / 2, id);	
-			}
-		for (int i = 115; i < x_length - 1; i++)
-			for (int j = 11; j <= 43; j++)
-			{
-				int id = rand() % 14 + 1;
-				if (id != 5 && id != 6 && id != 12 && id != 13 && id != 14)id = 6;
-				CreateItemBlockByLocation(i * block_size + block_size / 2, j * block_size + block_size / 2, id);
-			}
-		for (int i = 106; i < x_length - 1; i++)
-			for (int j = 44; j < y_length - 1; j++)
-			{
-				int id = rand() % 14 + 1;
-				if (id != 5 && id != 6 && id != 12 && id != 13 && id != 14)id = 6;
-				CreateItemBlockByLocation(i * block_size + block_size / 2, j * block_size + block_size / 2, id);
-			}
-		for (int i = 72; i <= 105; i++)
-			for (int j = 114; j < y_length - 1; j++)
-			{
-				int id = rand() % 14 + 1;
-				if (id != 5 && id != 6 && id != 12 && id != 13 && id != 14)id = 6;
-				CreateItemBlockByLocation(i * block_size + block_size / 2, j * block_size + block_size / 2, id);
-			}
-		for (int i = 0; i < x_length; i++)//wall
+
+	//Every chunk, nearest to where the character spawns first
+	int32 chunk_size = DataSystem->get_chunk_size();
+	int32 block_size = FMath::Max(DataSystem->get_ground_block_size(), 1);
+	FVector spawn_location = GetGameInstance()->GetSubsystem<UCharacterManager>()->GetSpawnLocation();
+	FIntPoint spawn_chunk(static_cast<int32>(spawn_location.X / block_size) / chunk_size, static_cast<int32>(spawn_location.Y / block_size) / chunk_size);
+	is_chunk_registered_.Init(false, DataSystem->get_chunk_x_count() * DataSystem->get_chunk_y_count());
+	unregistered_chunks_.Reset(is_chunk_registered_.Num());
+	for (int32 i = 0; i < DataSystem->get_chunk_x_count(); i++)
+		for (int32 j = 0; j < DataSystem->get_chunk_y_count(); j++)
 		{
-			CreateItemBlockByLocation(static_cast<float>(i * block_size + block_size / 2), static_cast<float>(block_size / 2), 4);
-			CreateItemBlockByLocation(static_cast<float>(i * block_size + block_size / 2), static_cast<float>(y_length * block_size - block_size / 2), 4);
+			unregistered_chunks_.Add(FIntPoint(i, j));
 		}
-		for (int i = 0; i < y_length; i++)//wall
+	unregistered_chunks_.Sort([spawn_chunk](const FIntPoint& a, const FIntPoint& b)
 		{
-			CreateItemBlockByLocation(static_cast<float>(block_size / 2), static_cast<float>(i * block_size + block_size / 2), 4);
-			CreateItemBlockByLocation(static_cast<float>(x_length * block_size - block_size / 2), static_cast<float>(i * block_size + block_size / 2), 4);
-		}
-		GetGameInstance()->GetSubsystem<UDataSystem>()->set_is_items_initialized(true);
-	}
+			return FMath::Max(FMath::Abs(a.X - spawn_chunk.X), FMath::Abs(a.Y - spawn_chunk.Y)) < FMath::Max(FMath::Abs(b.X - spawn_chunk.X), FMath::Abs(b.Y - spawn_chunk.Y));
+		});
+	is_registering_items_ = true;
 
-	/*----------------------------------------------TEST BLOCK------------------------------------------*/
-	InvokeUIMenu();
-	UClass* WidgetClass = LoadClass<UUserWidget>(nullptr, TEXT("WidgetBlueprint'/Game/UMG/WBP_Shortcut.WBP_Shortcut_C'"));
-	if (WidgetClass)
+	//The chunks the character spawns among now, the rest as the worker decodes them
+	for (int32 i = spawn_chunk.X - kChunkLoadRadius; i <= spawn_chunk.X + kChunkLoadRadius; i++)
+		for (int32 j = spawn_chunk.Y - kChunkLoadRadius; j <= spawn_chunk.Y + kChunkLoadRadius; j++)
+		{
+			if (i < 0 || j < 0 || i >= DataSystem->get_chunk_x_count() || j >= DataSystem->get_chunk_y_count())continue;
+			DataSystem->DecodeTiles(i * chunk_size, j * chunk_size, (i + 1) * chunk_size - 1, (j + 1) * chunk_size - 1);
+			RegisterChunkItems(i, j);
+		}
+}
+bool USceneManager::GenerateItems(double deadline)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	int32 chunk_size = DataSystem->get_chunk_size();
+	int32 chunk = 0;
+	while (chunk < unregistered_chunks_.Num())
 	{
-		UUserWidget* Widget = CreateWidget<UUserWidget>(GetGameInstance(), WidgetClass);
-
-		if (Widget)
+		if (chunk % 16 == 0 && FPlatformTime::Seconds() >= deadline)break;//Checked every 16 chunks
+		FIntPoint point = unregistered_chunks_[chunk];
+		if (!DataSystem->IsTilesDecoded(point.X * chunk_size, point.Y * chunk_size, (point.X + 1) * chunk_size - 1, (point.Y + 1) * chunk_size - 1))
 		{
-			Widget->AddToViewport();
+			chunk++;//Waits for the worker
+			continue;
 		}
+		RegisterChunkItems(point.X, point.Y);
+		unregistered_chunks_.RemoveAt(chunk, 1, false);
 	}
-	/*for (int i = 0; i <= 16; i++)
-	{
-		CreateItemBlockByLocation(3 * block_size, (i + 1) * block_size, i);
-	}*/
-	/*----------------------------------------------TEST BLOCK------------------------------------------*/
+	//The item blocks are spawned when their chunks are loaded
+	if (unregistered_chunks_.Num() > 0)return false;
+	DataSystem->set_is_temperature_initialized(true);
+	return true;
+}
+void USceneManager::RegisterChunkItems(int32 chunk_x, int32 chunk_y)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	if (!is_registering_items_)return;
+	int32 chunk = chunk_x * DataSystem->get_chunk_y_count() + chunk_y;
+	if (!is_chunk_registered_.IsValidIndex(chunk) || is_chunk_registered_[chunk])return;
+	is_chunk_registered_[chunk] = true;//Left in unregistered_chunks_, GenerateItems drops it
+
+	int32 chunk_size = DataSystem->get_chunk_size();
+	DataSystem->get_tiles().ForEachTileInRect(chunk_x * chunk_size, chunk_y * chunk_size, (chunk_x + 1) * chunk_size - 1, (chunk_y + 1) * chunk_size - 1, [&](int32 x, int32 y, int32 index)
+		{
+			RegisterItem(x, y, index);
+		});
+}
+void USceneManager::RegisterItem(int32 x, int32 y, int32 index)
+{
+	int32 id = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id_unchecked(index);
+	if (id == -1)return;
+	const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(id);
+	if (item_info == nullptr)return;
+	if (is_fire_applied_ && item_info->is_fire())ApplyFireTemperature(x, y, 20);
+	if (item_info->is_crop())GetGameInstance()->GetSubsystem<UCropSystem>()->AddCrop(x, y, item_register_minute_);
 }
 UClass* USceneManager::TypeToClass(FString type)//unused.
 {
 	UClass* item_class = nullptr;
-	if (type == "item_block_tree") item_class = LoadObject<UClass>(nullptr, TEXT("/Game/ItemBlock/BP_item_block_tree.BP_item_block_tree_C"));
-	else if (type == "item_block_transparent_wall") item_class = LoadObject<UClass>(nullptr, TEXT("/Game/ItemBlock/BP_item_block_transparent_wall.BP_item_block_transparent_wall_C"));
-	else if (type == "item_block_crop_wheat") item_class = LoadObject<UClass>(nullptr, TEXT("/Game/ItemBlock/BP_crop/BP_item_block_crop_wheat.BP_item_block_crop_wheat_C"));
+	UAssetCatalog* AssetCatalog = GetGameInstance()->GetSubsystem<UAssetCatalog>();
+	if (type == "item_block_tree") item_class = AssetCatalog->GetClass(EAssetKey::TreeBlockClass);
+	else if (type == "item_block_transparent_wall") item_class = AssetCatalog->GetClass(EAssetKey::TransparentWallBlockClass);
+	else if (type == "item_block_crop_wheat") item_class = AssetCatalog->GetClass(EAssetKey::WheatCropBlockClass);
 	return item_class;
 }
-void USceneManager::WaterCropAtLocation(float x, float y)
+void USceneManager::WaterCropAtTile(ETileEvent type, int32 x_index, int32 y_index, int32 value)
 {
-	int x_index, y_index;
-	GetIndexOfTheGroundBlockByLocation(x, y, x_index, y_index);
 	int32 item_id = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(x_index, y_index);
-	AItemBlockBase* item_class = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block(x_index, y_index);
 
-	UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBlockBase.DT_ItemBlockBase"));
-	FStruct_ItemBlockBase* item_info = item_data_table->FindRow<FStruct_ItemBlockBase>(FName(*FString::FromInt(item_id)), "");
+	const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(item_id);
 
 	if (item_info == nullptr)return;
-	if (item_info->type_ == 1)//crop
+	if (item_info->is_crop())//crop
 	{
 		//UE_LOG(LogTemp, Warning, TEXT("Watering Crop %d, %d"), x_index, y_index);
-		item_class->WaterThisCrop();
+		GetGameInstance()->GetSubsystem<UCropSystem>()->WaterCrop(x_index, y_index);
 	}
 }
 void USceneManager::ItemBlockInteractionHandler(int32 interaction_type, int32 damage, float x, float y)
@@ -500,21 +728,20 @@ void USceneManager::ItemBlockInteractionHandler(int32 interaction_type, int32 da
 	int32 item_id = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_id(x_index, y_index);
 	
 	if (item_id == -1)return;
-	UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBlockBase.DT_ItemBlockBase"));
-	FStruct_ItemBlockBase* item_info = item_data_table->FindRow<FStruct_ItemBlockBase>(FName(*FString::FromInt(item_id)), "");
+	const FItemDefinition* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemDefinition(item_id);
 	if (item_info == nullptr)return;
 	else
 	{
-		if (item_info->interaction_accepted_.Find(interaction_type) != INDEX_NONE)//interaction accepted
+		if (item_info->is_interaction_accepted(interaction_type))//interaction accepted
 		{
 			int32 previous_durability = GetGameInstance()->GetSubsystem<UDataSystem>()->get_item_block_durability(x_index, y_index);
 			GetGameInstance()->GetSubsystem<UDataSystem>()->set_item_block_durability(x_index, y_index, previous_durability - damage);
 			//UE_LOG(LogTemp, Warning, TEXT("Durability: %d"), previous_durability - damage);
 			if (previous_durability - damage <= 0)
 			{
-				for (auto item : item_info->map_item_drop_)
+				for (const TPair<int32, int32>& item : item_info->item_drop_)
 				{
-					GetGameInstance()->GetSubsystem<UEventSystem>()->OnGivenItems.Broadcast(item.Key, item.Value);
+					GetGameInstance()->GetSubsystem<UEventSystem>()->PostGivenItems(item.Key, item.Value);
 				}
 				DestroyItemBlockByLocation(x, y);
 			}
@@ -534,7 +761,7 @@ void USceneManager::InvokeUIMenu()
 	}
 	else is_menu_exist = true;
 	GetGameInstance()->GetFirstLocalPlayerController()->SetPause(true);
-	UClass* WidgetClass = LoadClass<UUserWidget>(nullptr, TEXT("/Game/UMG/WBP_Menu.WBP_Menu_C"));
+	UClass* WidgetClass = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetClass(EAssetKey::MenuWidgetClass);
 	GetWorld()->GetFirstPlayerController()->bShowMouseCursor = true;
 	if (WidgetClass)
 	{
@@ -551,3 +778,118 @@ void USceneManager::SetIsMenuExistToFalse()
 {
 	is_menu_exist = false;
 }
+/*-----------------------------------------------Chunk-----------------------------------------*/
+void USceneManager::UpdateLoadedChunks(int32 chunk_x, int32 chunk_y)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	player_chunk_ = FIntPoint(chunk_x, chunk_y);
+
+	//Release the chunks that are far away. A bit further than the load radius, so walking on the border does not reload chunks
+	for (int32 i = loaded_chunks_.Num() - 1; i >= 0; i--)
+	{
+		FIntPoint chunk = loaded_chunks_[i];
+		if (FMath::Abs(chunk.X - chunk_x) > kChunkReleaseRadius || FMath::Abs(chunk.Y - chunk_y) > kChunkReleaseRadius)
+		{
+			ReleaseChunk(chunk.X, chunk.Y);
+			loaded_chunks_.RemoveAtSwap(i);
+		}
+	}
+
+	//Queue the chunks around the player, they count as loaded from now on
+	for (int32 i = chunk_x - kChunkLoadRadius; i <= chunk_x + kChunkLoadRadius; i++)
+		for (int32 j = chunk_y - kChunkLoadRadius; j <= chunk_y + kChunkLoadRadius; j++)
+		{
+			if (i < 0 || j < 0 || i >= DataSystem->get_chunk_x_count() || j >= DataSystem->get_chunk_y_count())continue;
+			if (DataSystem->get_is_chunk_loaded(i, j))continue;
+			DataSystem->set_is_chunk_loaded(i, j, true);
+			loaded_chunks_.Add(FIntPoint(i, j));
+			pending_chunks_.Add(FIntPoint(i, j));
+		}
+
+	//Nearest first. Loading a tile twice does nothing, so the first chunk may start over
+	FIntPoint center = player_chunk_;
+	pending_chunks_.StableSort([center](const FIntPoint& a, const FIntPoint& b)
+		{
+			return FMath::Max(FMath::Abs(a.X - center.X), FMath::Abs(a.Y - center.Y)) < FMath::Max(FMath::Abs(b.X - center.X), FMath::Abs(b.Y - center.Y));
+		});
+	pending_chunk_tile_ = 0;
+}
+void USceneManager::LoadPendingChunks(double deadline)
+{
+	if (ground_renderer_ == nullptr || pending_chunks_.Num() == 0)return;//The map is not ready yet
+	ground_renderer_->BeginBatchUpdate();
+	while (pending_chunks_.Num() > 0)
+	{
+		FIntPoint chunk = pending_chunks_[0];
+		if (!LoadChunk(chunk.X, chunk.Y, pending_chunk_tile_, deadline))break;
+		pending_chunks_.RemoveAt(0);
+		pending_chunk_tile_ = 0;
+		if (FPlatformTime::Seconds() >= deadline)break;
+	}
+	ground_renderer_->EndBatchUpdate();
+}
+bool USceneManager::LoadChunk(int32 chunk_x, int32 chunk_y, int32& tile, double deadline)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	int32 chunk_size = DataSystem->get_chunk_size();
+	FTileStore& tiles = DataSystem->get_tiles();
+	const int32 kTileCount = chunk_size * chunk_size;
+	const int32 first_tile = tile;
+	if (tile == 0)
+	{
+		//A chunk of a save the worker has not decoded yet is decoded now, its crops grow before their blocks are spawned
+		DataSystem->DecodeTiles(chunk_x * chunk_size, chunk_y * chunk_size, (chunk_x + 1) * chunk_size - 1, (chunk_y + 1) * chunk_size - 1);
+		RegisterChunkItems(chunk_x, chunk_y);
+		//Only the crops of the drawn chunks can be watered, the watering of a tile reaches the chunk it is in
+		FIntPoint chunk(chunk_x, chunk_y);
+		if (!water_crop_subscriptions_.Contains(chunk))
+		{
+			int32 subscription = GetGameInstance()->GetSubsystem<UEventSystem>()->SubscribeChunkEvent(ETileEvent::WaterCrop, chunk_x, chunk_y, FTileEventDelegate::CreateUObject(this, &USceneManager::WaterCropAtTile));
+			if (subscription != INDEX_NONE)water_crop_subscriptions_.Add(chunk, subscription);
+		}
+	}
+	for (; tile < kTileCount; tile++)
+	{
+		if (tile != first_tile && tile % chunk_size == 0 && FPlatformTime::Seconds() >= deadline)return false;//Checked once per row of the chunk
+		int32 x = chunk_x * chunk_size + tile / chunk_size;
+		int32 y = chunk_y * chunk_size + tile % chunk_size;
+		if (!tiles.IsValidIndex(x, y))continue;
+		int32 index = tiles.Index(x, y);
+		EGroundType type = FTileStore::At(tiles.ground_type_, index);
+		if (ground_renderer_ != nullptr && type != EGroundType::None)
+		{
+			ground_renderer_->UpdateGroundInstance(x, y, static_cast<int32>(type));
+		}
+		if (FTileStore::At(tiles.item_id_, index) != -1)SpawnItemBlock(x, y);
+	}
+	return true;
+}
+void USceneManager::ReleaseChunk(int32 chunk_x, int32 chunk_y)
+{
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	DataSystem->set_is_chunk_loaded(chunk_x, chunk_y, false);
+	if (pending_chunks_.Num() > 0 && pending_chunks_[0] == FIntPoint(chunk_x, chunk_y))pending_chunk_tile_ = 0;
+	pending_chunks_.Remove(FIntPoint(chunk_x, chunk_y));
+	int32 subscription = INDEX_NONE;
+	if (water_crop_subscriptions_.RemoveAndCopyValue(FIntPoint(chunk_x, chunk_y), subscription))
+	{
+		GetGameInstance()->GetSubsystem<UEventSystem>()->UnsubscribeTileEvent(subscription);
+	}
+	int32 chunk_size = DataSystem->get_chunk_size();
+	FTileStore& tiles = DataSystem->get_tiles();
+	tiles.ForEachTileInRect(chunk_x * chunk_size, chunk_y * chunk_size, (chunk_x + 1) * chunk_size - 1, (chunk_y + 1) * chunk_size - 1, [&](int32 x, int32 y, int32 index)
+		{
+			if (ground_renderer_ != nullptr)
+			{
+				ground_renderer_->RemoveGroundInstance(x, y);
+			}
+			//The state of the item block stays in the data system
+			AItemBlockBase*& item_block = FTileStore::At(tiles.item_block_, index);
+			if (item_block != nullptr)
+			{
+				AItemBlockBase* released_block = item_block;
+				item_block = nullptr;
+				released_block->Destroy();
+			}
+		});
+}
@@ -9,23 +9,61 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "GroundType.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "SceneManager.generated.h"
 
+struct FGeneratedMap;
+enum class ETileEvent : uint8;
+
+/**
+ * The stages of building the world, in order.
+ */
+enum class EWorldBuildStage : uint8
+{
+	WaitingForWorld,//The world has not begun play or there is no player controller yet
+	GeneratingMap,//The map is generated on a worker thread, or a saved map is being drawn
+	RegisteringItems,//The fires and crops around the spawn point are registered, the rest after the world is ready
+	SpawningCharacter,
+	LoadingChunks,//The chunks around the player are loaded, a slice per frame
+	Ready
+};
+
 /**
  * 
  */
 UCLASS()
-class STARDEWVALLEY_API USceneManager : public UGameInstanceSubsystem
+class STARDEWVALLEY_API USceneManager : public UGameInstanceSubsystem, public FTickableGameObject
 {
 	GENERATED_BODY()
 	
 public:
 	void Initialize(FSubsystemCollectionBase& Collection) override;
 	void Deinitialize() override;
+
+	// FTickableGameObject, builds the world and loads the queued chunks
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return world_build_stage_ != EWorldBuildStage::Ready || pending_chunks_.Num() > 0 || ground_swap_queue_.Num() > 0 || is_registering_items_; };
+	virtual bool IsTickableWhenPaused() const override { return true; };
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	//World building
+	EWorldBuildStage get_world_build_stage() const { return world_build_stage_; };
+	bool is_world_ready() const { return world_build_stage_ == EWorldBuildStage::Ready; };
+	/**
+	 * \brief Get how much of the world has been built.
+	 *
+	 * \return A float, from 0 to 1
+	 */
+	float get_world_build_progress() const;
 	//Ground Blocks
 	UFUNCTION()
 	/**
-	 * \brief Generate the Ground blocks.
+	 * \brief Generate the Ground blocks. A saved map is drawn at once,
+	 * \brief a new map is generated from the seed on a worker thread and drawn when it is done.
 	 * 
 	 */
 	void GenerateMap();
@@ -66,21 +104,23 @@ public:
 	void DestroyGroundBlockByLocation(float x, float y);
 	/**
 	 * \brief Create the ground block of the given type at the given location.
-	 * \brief The ground block will be destroyed if it already exists.
-	 * \brief The ground block must be within the 128x128 grid.
+	 * \brief The ground block will be replaced if it already exists.
+	 * \brief The ground block must be within the grid.
 	 * 
 	 * \param x the x location of the ground block
 	 * \param y the y location of the ground block
 	 * \param type the type of the ground block
 	 */
-	void CreateGroundBlockByLocation(float x, float y, FString type);
+	void CreateGroundBlockByLocation(float x, float y, EGroundType type);
 	/**
 	 * \brief Change all the earth ground to snow ground. Called when winter starts.
+	 * \brief The data changes at once, the drawn ground follows over a few frames.
 	 * 
 	 */
 	void ChangeEarthGroundToSnowGround();
 	/**
 	 * \brief Change all the snow ground to earth ground. Called when spring starts.
+	 * \brief The data changes at once, the drawn ground follows over a few frames.
 	 * 
 	 */
 	void ChangeSnowGroundToEarthGround();
@@ -116,17 +156,28 @@ public:
 	 */
 	void DestroyItemBlockByLocation(float x, float y);
 	/**
-	 * \brief Generate the items.
+	 * \brief Register the items of the chunks around where the character spawns, the fires warm the ground and the crops are added to the crop system.
+	 * \brief The other chunks are registered by GenerateItems after the world is ready, or by LoadChunk if they are loaded first.
+	 * 
+	 */
+	void GenerateSpawnItems();
+	/**
+	 * \brief Register the items of the chunks the save has been decoded for, nearest to the spawn first, until the deadline.
+	 * \brief The crops catch up with the minutes since the world was built.
 	 * 
+	 * \param deadline The time of FPlatformTime::Seconds to stop at
+	 * \return A bool, true if every chunk has been registered
 	 */
-	void GenerateItems();
+	bool GenerateItems(double deadline);
 	/**
-	 * \brief Waters the crop at the given location.
+	 * \brief Waters the crop at the given tile. Subscribed per loaded chunk, the crops of the other chunks cannot be reached.
 	 * 
-	 * \param x The x location of the crop
-	 * \param y The y location of the crop
+	 * \param type The event, ETileEvent::WaterCrop
+	 * \param x_index The first index of the crop
+	 * \param y_index The second index of the crop
+	 * \param value Not used
 	 */
-	void WaterCropAtLocation(float x, float y);
+	void WaterCropAtTile(ETileEvent type, int32 x_index, int32 y_index, int32 value);
 	/**
 	 * \brief Handles the interaction.
 	 * 
@@ -135,6 +186,50 @@ public:
 	 * \param y The y location of the interaction, a float
 	 */
 	void ItemBlockInteractionHandler(int32 interaction_type, int32 damage, float x, float y);
+	/**
+	 * \brief Spawn the item block actor of the data at the given index. Does nothing if there is no item or it is already spawned.
+	 * 
+	 * \param x_index The first index of the item block
+	 * \param y_index The second index of the item block
+	 */
+	void SpawnItemBlock(int32 x_index, int32 y_index);
+	/**
+	 * \brief Change the temperature of the ground around a fire.
+	 * 
+	 * \param x_index The first index of the fire
+	 * \param y_index The second index of the fire
+	 * \param delta_temperature The temperature to add
+	 */
+	void ApplyFireTemperature(int32 x_index, int32 y_index, int32 delta_temperature);
+
+	//Chunks
+	/**
+	 * \brief Queue the chunks around the player to be loaded and release the ones far away. Called when the player enters another chunk.
+	 * \brief The queued chunks are loaded nearest first, within the frame budget.
+	 * 
+	 * \param chunk_x The first index of the chunk the player is in
+	 * \param chunk_y The second index of the chunk the player is in
+	 */
+	void UpdateLoadedChunks(int32 chunk_x, int32 chunk_y);
+	/**
+	 * \brief Draw the ground and spawn the item blocks of the chunk from the data system, tile by tile until the deadline.
+	 * \brief Loading a tile again does nothing, so a chunk can be loaded from any tile.
+	 * 
+	 * \param chunk_x The first index of the chunk
+	 * \param chunk_y The second index of the chunk
+	 * \param tile Return value. The tile in the chunk to go on from, the number of tiles of the chunk when it is done
+	 * \param deadline The time of FPlatformTime::Seconds to stop at, at least one tile is loaded
+	 * \return A bool, true if the chunk has been loaded
+	 */
+	bool LoadChunk(int32 chunk_x, int32 chunk_y, int32& tile, double deadline);
+	/**
+	 * \brief Remove the ground and the item blocks of the chunk. Their data stays in the data system.
+	 * 
+	 * \param chunk_x The first index of the chunk
+	 * \param chunk_y The second index of the chunk
+	 */
+	void ReleaseChunk(int32 chunk_x, int32 chunk_y);
+
 	void InvokeUIMenu();
 	void SetIsMenuExistToFalse();
 
@@ -142,10 +237,86 @@ public:
 	struct item_size { int32 x_length; int32 y_length; };
 	TMap<FString, item_size> TypeToSizeMap;
 private:
-	FTimerHandle timer_handler_;
-	const int kMaxLength = 128;
+	UPROPERTY()
+	class AGroundRenderer* ground_renderer_;
+	const int kMaxLength = 1024;
 	const int kDefaultBlockSize = 200;
 	const int kHeight = 0;
+	const int kChunkLoadRadius = 2;
+	const int kChunkReleaseRadius = 3;
+	TArray<FIntPoint> loaded_chunks_;
+	TMap<FIntPoint, int32> water_crop_subscriptions_;//The tile subscription of each drawn chunk, removed when the chunk is released
 	bool is_menu_exist;
+	FGraphEventRef map_generation_task_;//Completes after the generated map is applied
+	EWorldBuildStage world_build_stage_;
+	double world_build_start_time_;
+	TArray<FIntPoint> unregistered_chunks_;//Nearest to the spawn first, the ones GenerateItems has not gone through
+	TBitArray<> is_chunk_registered_;//Index = chunk_x * chunk_y_count + chunk_y
+	bool is_registering_items_;//GenerateItems has chunks left
+	bool is_fire_applied_;//The fires warm the ground when registered
+	int32 item_register_minute_;//The minute of the crop system the items were loaded at, the crops registered late catch up from it
+	TArray<FIntPoint> pending_chunks_;//Marked loaded but not drawn yet, nearest to the player first
+	int32 pending_chunk_tile_;//The tile of the first pending chunk to go on from
+	int32 initial_chunk_count_;//The chunks queued when the character spawned
+	FIntPoint player_chunk_;
+	UPROPERTY()
+	class ULoadingWidget* loading_widget_;
+	TArray<int32> ground_swap_queue_;//Loaded tiles whose drawn ground is behind the data
+	int32 ground_swap_cursor_;//The next tile of the queue to draw
+	float ground_transition_time_;//Seconds into the cross-fade before the swap, negative if there is none
+	UPROPERTY()
+	class UMaterialParameterCollection* season_parameters_;//Optional, the ground materials fade to the next season by GroundTransition
+	const float kGroundTransitionDuration = 2.0f;
+	//The share of the progress bar of each stage
+	const float kMapProgress = 0.3f;
+	const float kItemProgress = 0.2f;
+private:
+	/**
+	 * \brief Whether the world can be built: it has begun play, the player controller exists and the assets are preloaded.
+	 */
+	bool IsWorldReadyToBuild() const;
+	/**
+	 * \brief Load the queued chunks until the deadline.
+	 */
+	void LoadPendingChunks(double deadline);
+	/**
+	 * \brief Remove the loading screen, start the clock and show the menu. Broadcasts OnWorldReady.
+	 */
+	void FinishWorldBuild();
+	void ShowLoadingWidget();
+	/**
+	 * \brief Write the generated map to the data system. Called on the game thread.
+	 *
+	 * \param map The generated map
+	 */
+	void ApplyGeneratedMap(FGeneratedMap& map);
+	/**
+	 * \brief Spawn the ground renderer for the map of the data system and draw the chunks already loaded.
+	 */
+	void SpawnGroundRenderer();
+	/**
+	 * \brief Change every ground block of one type to another type. The delta temperature is kept.
+	 * \brief The loaded tiles are queued to be drawn by UpdateGroundTransition.
+	 *
+	 * \param from The type to be replaced
+	 * \param to The new type
+	 */
+	void ReplaceGroundType(EGroundType from, EGroundType to);
+	/**
+	 * \brief Fade the ground materials, then draw the queued tiles with their type in the data until the deadline.
+	 *
+	 * \param DeltaTime The seconds of the frame
+	 * \param deadline The time of FPlatformTime::Seconds to stop at
+	 */
+	void UpdateGroundTransition(float DeltaTime, double deadline);
+	void SetGroundTransition(float alpha);
+	/**
+	 * \brief Register the items of a decoded chunk, unless they are already.
+	 */
+	void RegisterChunkItems(int32 chunk_x, int32 chunk_y);
+	/**
+	 * \brief Register the item of a tile, if any.
+	 */
+	void RegisterItem(int32 x, int32 y, int32 index);
 };
 
@@ -2,10 +2,11 @@
 
 
 #include "ShortcutBar.h"
-#include "Engine/DataTable.h"
 #include "Struct_ItemBase.h"
+#include "ItemRegistry.h"
 #include "Components/Image.h"
 #include "EventSystem.h"
+#include "AssetCatalog.h"
 
 bool UShortcutBar::Initialize()
 {
@@ -22,9 +23,9 @@ bool UShortcutBar::Initialize()
 		auto EventSystem = GameInstance->GetSubsystem<UEventSystem>();
 		if (EventSystem != nullptr)
 		{
-			EventSystem->OnItemAddedToShortcutBar.AddUObject(this, &UShortcutBar::AddItemToShortcutBar);
-			EventSystem->OnItemRemovedFromShortcutBar.AddUObject(this, &UShortcutBar::RemoveItemFromShortcutBar);
-			EventSystem->OnShortcutSelected.AddUObject(this, &UShortcutBar::HighLightActiveItem);
+			EventSystem->Subscribe(EventSystem->OnItemAddedToShortcutBar, TEXT("OnItemAddedToShortcutBar"), this, &UShortcutBar::AddItemToShortcutBar);
+			EventSystem->Subscribe(EventSystem->OnItemRemovedFromShortcutBar, TEXT("OnItemRemovedFromShortcutBar"), this, &UShortcutBar::RemoveItemFromShortcutBar);
+			EventSystem->Subscribe(EventSystem->OnShortcutSelected, TEXT("OnShortcutSelected"), this, &UShortcutBar::HighLightActiveItem);
 		}
 	}
 	return true;
@@ -32,8 +33,7 @@ bool UShortcutBar::Initialize()
 
 void UShortcutBar::AddItemToShortcutBar(int32 id, int32 index)
 {
-	UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBase.DT_ItemBase"));
-	FStruct_ItemBase* item_info = item_data_table->FindRow<FStruct_ItemBase>(FName(*FString::FromInt(id)), "");
+	const FStruct_ItemBase* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemInfo(id);
 	FName name = FName("IcoItem_" + FString::FromInt(index));
 	UE_LOG(LogTemp, Warning, TEXT("name = %s"), *name.ToString());
 	UImage* image = Cast<UImage>(GetWidgetFromName(name));
@@ -50,7 +50,7 @@ void UShortcutBar::AddItemToShortcutBar(int32 id, int32 index)
 	}
 	else
 	{
-		UTexture2D* texture = LoadObject<UTexture2D>(nullptr, TEXT("Texture2D'/Game/Asset/Icon/Ico_Test_4oD.Ico_Test_4oD'"));
+		UTexture2D* texture = GetGameInstance()->GetSubsystem<UAssetCatalog>()->Get<UTexture2D>(EAssetKey::MissingIcon);
 		FSlateBrush brush;
 		brush.SetResourceObject(texture);
 		image->SetBrush(brush);
@@ -64,7 +64,7 @@ void UShortcutBar::RemoveItemFromShortcutBar(int32 index)
 	UImage* image = Cast<UImage>(GetWidgetFromName(name));
 	if (image != nullptr)
 	{
-		UTexture2D* texture = LoadObject<UTexture2D>(nullptr, TEXT("Texture2D'/Game/Asset/Icon/Ico_Axe_Level1.Ico_Axe_Level1'"));
+		UTexture2D* texture = GetGameInstance()->GetSubsystem<UAssetCatalog>()->Get<UTexture2D>(EAssetKey::EmptyShortcutIcon);
 		FSlateBrush brush;
 		brush.SetResourceObject(texture);
 		image->SetBrush(brush);
@@ -24,13 +24,11 @@ void UStardewValleyGameInstance::Init()
 	USceneManager* SceneManager = GetSubsystem<USceneManager>();
 	UCharacterManager* CharacterManager = GetSubsystem<UCharacterManager>();
 
-	TimeSystem->set_minute(DataSystem->get_minute());
-	TimeSystem->set_hour(DataSystem->get_hour());
-	TimeSystem->set_day_in_season(DataSystem->get_day_in_season());
-	TimeSystem->set_season(DataSystem->get_present_season());
-	WeatherSystem->set_weather(DataSystem->get_present_weather());
-	DataSystem->set_ground_block_x_length(128);
-	DataSystem->set_ground_block_y_length(128);
-	DataSystem->set_ground_block_size(200);
+	DataSystem->SyncLoadedTimeAndWeather();
+	if (!DataSystem->is_items_initialized())//The size of a saved map is kept, a new map is sized when it is generated
+	{
+		DataSystem->set_ground_block_lengths(128, 128);
+		DataSystem->set_ground_block_size(200);
+	}
 
 }
@@ -0,0 +1,135 @@
+/*****************************************************************
+ * \file   TileStore.h
+ * \brief  The data of every block of the map, one array per field.
+ * \brief  Sized once from the map size. Blocks are stored row by row, index = x * y_length + y.
+ *
+ * \author 4_of_Diamonds
+ * \date   December 2024
+ *********************************************************************/
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GroundType.h"
+
+class AItemBlockBase;
+
+struct FTileStore
+{
+public:
+	//One element per block
+	TArray<EGroundType> ground_type_;
+	TArray<int32> delta_temperature_;
+	TArray<AItemBlockBase*> item_block_;
+	TArray<int32> item_id_;
+	TArray<int32> lived_time_;
+	TArray<int32> durability_;
+	TArray<bool> is_watered_;
+private:
+	int32 x_length_ = 0;
+	int32 y_length_ = 0;
+public:
+	/**
+	 * \brief Size every array for the given map and fill them with the empty values.
+	 *
+	 * \param x_length The number of blocks in x direction
+	 * \param y_length The number of blocks in y direction
+	 */
+	void Reset(int32 x_length, int32 y_length)
+	{
+		x_length_ = FMath::Max(x_length, 0);
+		y_length_ = FMath::Max(y_length, 0);
+		int32 num = x_length_ * y_length_;
+		ground_type_.Init(EGroundType::None, num);
+		delta_temperature_.Init(0, num);
+		item_block_.Init(nullptr, num);
+		item_id_.Init(-1, num);
+		lived_time_.Init(-1, num);
+		durability_.Init(-1, num);
+		is_watered_.Init(false, num);
+	}
+	int32 Num() const { return x_length_ * y_length_; }
+	int32 get_x_length() const { return x_length_; }
+	int32 get_y_length() const { return y_length_; }
+	bool IsValidIndex(int32 index) const { return index >= 0 && index < Num(); }
+	bool IsValidIndex(int32 x, int32 y) const { return x >= 0 && y >= 0 && x < x_length_ && y < y_length_; }
+	int32 Index(int32 x, int32 y) const { return x * y_length_ + y; }
+
+	/**
+	 * \brief Get an element without bounds checking. The index must be valid.
+	 */
+	template<typename T>
+	static FORCEINLINE T& At(TArray<T>& layer, int32 index) { return layer.GetData()[index]; }
+	template<typename T>
+	static FORCEINLINE const T& At(const TArray<T>& layer, int32 index) { return layer.GetData()[index]; }
+
+	/**
+	 * \brief Set every element of the array.
+	 */
+	template<typename T>
+	static void Fill(TArray<T>& layer, const T& value)
+	{
+		T* data = layer.GetData();
+		for (int32 i = 0; i < layer.Num(); i++)
+		{
+			data[i] = value;
+		}
+	}
+	/**
+	 * \brief Set the elements of the blocks in [x_begin, x_end] x [y_begin, y_end]. The rectangle is clipped to the map.
+	 */
+	template<typename T>
+	void FillRect(TArray<T>& layer, int32 x_begin, int32 y_begin, int32 x_end, int32 y_end, const T& value) const
+	{
+		ForEachTileInRect(x_begin, y_begin, x_end, y_end, [&layer, &value](int32 x, int32 y, int32 index)
+			{
+				At(layer, index) = value;
+			});
+	}
+	/**
+	 * \brief Copy the given elements to the front of the array. Elements past the end of the array are dropped.
+	 *
+	 * \return The number of elements copied
+	 */
+	template<typename T>
+	static int32 CopyLayer(TArray<T>& layer, const TArray<T>& source)
+	{
+		int32 num = FMath::Min(layer.Num(), source.Num());
+		for (int32 i = 0; i < num; i++)
+		{
+			At(layer, i) = At(source, i);
+		}
+		return num;
+	}
+
+	/**
+	 * \brief Call func(x, y, index) for every block, row by row.
+	 */
+	template<typename FuncType>
+	void ForEachTile(FuncType&& func) const
+	{
+		for (int32 x = 0, index = 0; x < x_length_; x++)
+			for (int32 y = 0; y < y_length_; y++, index++)
+			{
+				func(x, y, index);
+			}
+	}
+	/**
+	 * \brief Call func(x, y, index) for every block in [x_begin, x_end] x [y_begin, y_end], row by row. The rectangle is clipped to the map.
+	 */
+	template<typename FuncType>
+	void ForEachTileInRect(int32 x_begin, int32 y_begin, int32 x_end, int32 y_end, FuncType&& func) const
+	{
+		x_begin = FMath::Max(x_begin, 0);
+		y_begin = FMath::Max(y_begin, 0);
+		x_end = FMath::Min(x_end, x_length_ - 1);
+		y_end = FMath::Min(y_end, y_length_ - 1);
+		for (int32 x = x_begin; x <= x_end; x++)
+		{
+			int32 index = Index(x, y_begin);
+			for (int32 y = y_begin; y <= y_end; y++, index++)
+			{
+				func(x, y, index);
+			}
+		}
+	}
+};
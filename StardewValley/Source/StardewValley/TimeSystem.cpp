@@ -9,6 +9,7 @@
 #include "TimeSystem.h"
 #include "EventSystem.h"
 #include "DataSystem.h"
+#include "CropSystem.h"
 #include <stdexcept>
 
 UTimeSystem::UTimeSystem()
@@ -18,22 +19,31 @@ UTimeSystem::UTimeSystem()
 	day_in_season_ = 1;
 	season_ = Season::Spring;
 	time_flow_speed_ = 0.01f;
+	time_scale_ = 1.0f;
+	paused_time_scale_ = 1.0f;
+	accumulated_time_ = 0.0f;
+	is_clock_running_ = false;
+	present_minute_ = 0;
+	next_event_order_ = 0;
 }
 void UTimeSystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
-	FTimerDelegate timer_delegate;
+	ScheduleTimeEvents(Collection.InitializeDependency<UEventSystem>());
 	FTimerDelegate real_time_delegate;
-	timer_delegate.BindUObject(this, &UTimeSystem::TimeFlow);
 	real_time_delegate.BindUObject(this, &UTimeSystem::RealTimeRecord);
-	GetGameInstance()->GetWorld()->GetTimerManager().SetTimer(timer_handle_, timer_delegate, time_flow_speed_, true);
 	GetGameInstance()->GetWorld()->GetTimerManager().SetTimer(real_time_handle_, real_time_delegate, 1.0f, true);
+	accumulated_time_ = 0.0f;
+	is_clock_running_ = true;
 }
 
 void UTimeSystem::Deinitialize()
 {
 	Super::Deinitialize();
 
+	is_clock_running_ = false;
+	calendar_events_.Empty();
+	calendar_.Empty();
 	// Get the game instance and then the world
 	UGameInstance* GameInstance = GetGameInstance();
 	if (GameInstance)
@@ -42,127 +52,302 @@ void UTimeSystem::Deinitialize()
 		if (World)
 		{
 			// Clear the timer
-			World->GetTimerManager().ClearTimer(timer_handle_);
+			World->GetTimerManager().ClearTimer(real_time_handle_);
 		}
 	}
 }
 
+void UTimeSystem::Tick(float DeltaTime)
+{
+	if (time_scale_ <= 0.0f || time_flow_speed_ <= 0.0f)return;
+
+	//The clock runs on the frame time, so the game speed does not depend on the frame rate
+	accumulated_time_ += FMath::Min(DeltaTime, kMaxFrameTime) * time_scale_;
+	int32 elapsed_minutes = FMath::FloorToInt(accumulated_time_ / time_flow_speed_);
+	if (elapsed_minutes <= 0)return;
+	if (elapsed_minutes > kMaxMinutesPerFrame)
+	{
+		elapsed_minutes = kMaxMinutesPerFrame;
+		accumulated_time_ = 0.0f;
+	}
+	else
+	{
+		accumulated_time_ -= elapsed_minutes * time_flow_speed_;
+	}
+	AdvanceClock(elapsed_minutes, false);
+}
+
+ETickableTickType UTimeSystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UTimeSystem::GetTickableGameObjectWorld() const
+{
+	return GetGameInstance() ? GetGameInstance()->GetWorld() : nullptr;
+}
+
+TStatId UTimeSystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTimeSystem, STATGROUP_Tickables);
+}
+
+void UTimeSystem::SetTimeScale(float time_scale)
+{
+	time_scale_ = FMath::Clamp(time_scale, 0.0f, kMaxTimeScale);
+	if (time_scale_ <= 0.0f)accumulated_time_ = 0.0f;
+}
+
+void UTimeSystem::PauseTime()
+{
+	if (is_time_paused())return;
+	paused_time_scale_ = time_scale_;
+	SetTimeScale(0.0f);
+}
+
+void UTimeSystem::ResumeTime()
+{
+	if (!is_time_paused())return;
+	SetTimeScale(paused_time_scale_);
+}
+
 void UTimeSystem::Flow(const int32 kElapsedTimeInMinutes)
 {
 	if (kElapsedTimeInMinutes < 0)
 	{
 		throw std::invalid_argument("We don't go back in time!");
 	}
-	minute_ += kElapsedTimeInMinutes;
-
-	hour_ += minute_ / kMinutesInHour;
-	minute_ = minute_ % kMinutesInHour;
+	present_minute_ += kElapsedTimeInMinutes;
+	int64 total_minutes = static_cast<int64>(minute_) + kElapsedTimeInMinutes;
+	minute_ = static_cast<int32>(total_minutes % kMinutesInHour);
 
-	day_in_season_ += hour_ / kHoursInDay;
-	hour_ = hour_ % kHoursInDay;
+	int64 total_hours = hour_ + total_minutes / kMinutesInHour;
+	hour_ = static_cast<int32>(total_hours % kHoursInDay);
 
-	int elapsed_seasons = day_in_season_ / kDaysInSeason;
-	int final_season = static_cast<int>(season_) + elapsed_seasons;
+	//Count the days from the first day of the season, so a jump of many days crosses the right number of seasons
+	int64 total_days = (day_in_season_ - 1) + total_hours / kHoursInDay;
+	day_in_season_ = static_cast<int32>(total_days % kDaysInSeason) + 1;
+	int64 final_season = static_cast<int64>(season_) + total_days / kDaysInSeason;
 	season_ = static_cast<Season>(final_season % kSeasonsNum);
-	day_in_season_ = day_in_season_ % kDaysInSeason;
-	if(day_in_season_ == 0)day_in_season_ = 1;
 }
 
-void UTimeSystem::TimeFlow()
+void UTimeSystem::FastForward(const int32 kElapsedTimeInMinutes)
+{
+	if (kElapsedTimeInMinutes < 0)
+	{
+		throw std::invalid_argument("We don't go back in time!");
+	}
+	bool is_hour_changed = minute_ + kElapsedTimeInMinutes >= kMinutesInHour;
+	AdvanceClock(kElapsedTimeInMinutes, true);
+
+	//The base temperature only depends on the final hour
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (is_hour_changed)EventSystem->BroadcastEvent(EventSystem->OnHourChanged);
+}
+
+void UTimeSystem::SkipToTime(int32 hour, int32 minute)
+{
+	const int kMinutesInDay = kHoursInDay * kMinutesInHour;
+	int32 target_minute_of_day = FMath::Clamp(hour, 0, kHoursInDay - 1) * kMinutesInHour + FMath::Clamp(minute, 0, kMinutesInHour - 1);
+	int32 minute_of_day = hour_ * kMinutesInHour + minute_;
+	int32 elapsed_minutes = (target_minute_of_day - minute_of_day + kMinutesInDay) % kMinutesInDay;
+	if (elapsed_minutes == 0)elapsed_minutes = kMinutesInDay;//The same time tomorrow
+	FastForward(elapsed_minutes);
+}
+
+void UTimeSystem::SyncToDataSystem()
 {
-	//UE_LOG(LogTemp, Warning, TEXT("Called"));
-	Flow(1);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_minute(minute_);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_hour(hour_);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_day_in_season(day_in_season_);
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_present_season(static_cast<int32>(season_));
+}
 
-	//Broadcast time change events
-	if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnMinuteChanged.IsBound())
-		GetGameInstance()->GetSubsystem<UEventSystem>()->OnMinuteChanged.Broadcast();
-	if (minute_ == 0)
-	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnHourChanged.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnHourChanged.Broadcast();
-	}
-	if (hour_ == 0 && minute_ == 0)
-	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnDayChanged.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnDayChanged.Broadcast();
-	}
-	if (day_in_season_ == 1 && hour_ == 0 && minute_ == 0)
+void UTimeSystem::AdvanceClock(const int32 kElapsedTimeInMinutes, bool is_skipping)
+{
+	UCropSystem* CropSystem = GetGameInstance()->GetSubsystem<UCropSystem>();
+	int32 remaining_minutes = kElapsedTimeInMinutes;
+	while (remaining_minutes > 0)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnSeasonChanged.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnSeasonChanged.Broadcast();
+		//Run to the next due event at once, nothing changes in between
+		int64 minutes_to_event = calendar_.Num() > 0 ? calendar_.HeapTop().minute_ - present_minute_ : remaining_minutes;
+		int32 step = static_cast<int32>(FMath::Clamp<int64>(minutes_to_event, 1, remaining_minutes));
+		if (CropSystem)CropSystem->AdvanceCrops(step);
+		Flow(step);
+		SyncToDataSystem();
+		remaining_minutes -= step;
+		RunDueEvents(is_skipping);
 	}
 
-	//Broadcast events on key times
-	if (minute_ == 0 && hour_ == 2)
-	{
-		if(GetGameInstance()->GetSubsystem<UEventSystem>()->OnEarlyMorningBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnEarlyMorningBegin.Broadcast();
-	}
-	else if (minute_ == 0 && hour_ == 6)
-	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnMorningBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnMorningBegin.Broadcast();
-	}
-	else if (minute_ == 0 && hour_ == 10)
-	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnNoonBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnNoonBegin.Broadcast();
-	}
-	else if (minute_ == 0 && hour_ == 14)
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (!is_skipping && kElapsedTimeInMinutes > 0)EventSystem->BroadcastEvent(EventSystem->OnMinuteChanged);
+}
+
+void UTimeSystem::ScheduleTimeEvents(UEventSystem* EventSystem)
+{
+	auto Broadcast = [EventSystem](FMulticastDelegate& event)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnAfternoonBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnAfternoonBegin.Broadcast();
-	}
-	else if (minute_ == 0 && hour_ == 18)
+		return FSimpleDelegate::CreateWeakLambda(EventSystem, [EventSystem, &event]()
+			{
+				EventSystem->BroadcastEvent(event);
+			});
+	};
+	//Events due at the same minute run in this order. The hour and the day parts are not run when skipped
+	ScheduleHourlyEvent(0, Broadcast(EventSystem->OnHourChanged), false);
+	ScheduleDailyEvent(0, 0, Broadcast(EventSystem->OnDayChanged));
+	ScheduleSeasonalEvent(-1, 1, 0, 0, Broadcast(EventSystem->OnSeasonChanged));
+
+	ScheduleDailyEvent(2, 0, Broadcast(EventSystem->OnEarlyMorningBegin), false);
+	ScheduleDailyEvent(6, 0, Broadcast(EventSystem->OnMorningBegin), false);
+	ScheduleDailyEvent(10, 0, Broadcast(EventSystem->OnNoonBegin), false);
+	ScheduleDailyEvent(14, 0, Broadcast(EventSystem->OnAfternoonBegin), false);
+	ScheduleDailyEvent(18, 0, Broadcast(EventSystem->OnEveningBegin), false);
+	ScheduleDailyEvent(22, 0, Broadcast(EventSystem->OnNightBegin), false);
+
+	ScheduleSeasonalEvent(static_cast<int32>(Season::Spring), 1, 0, 0, Broadcast(EventSystem->OnSpringBegin));
+	ScheduleSeasonalEvent(static_cast<int32>(Season::Summer), 1, 0, 0, Broadcast(EventSystem->OnSummerBegin));
+	ScheduleSeasonalEvent(static_cast<int32>(Season::Autumn), 1, 0, 0, Broadcast(EventSystem->OnAutumnBegin));
+	ScheduleSeasonalEvent(static_cast<int32>(Season::Winter), 1, 0, 0, Broadcast(EventSystem->OnWinterBegin));
+
+	//For weather to change
+	ScheduleDailyEvent(8, 0, Broadcast(EventSystem->OnEightInMorning));
+	ScheduleDailyEvent(20, 0, Broadcast(EventSystem->OnEightInEvening));
+}
+
+int32 UTimeSystem::ScheduleEventAfter(const int32 kDelayInMinutes, FSimpleDelegate callback)
+{
+	if (kDelayInMinutes < 0)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnEveningBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnEveningBegin.Broadcast();
+		throw std::invalid_argument("We don't go back in time!");
 	}
-	else if (minute_ == 0 && hour_ == 22)
+	FCalendarEvent event;
+	event.callback_ = MoveTemp(callback);
+	event.period_ = 0;
+	event.offset_ = 0;
+	event.due_minute_ = present_minute_ + kDelayInMinutes;
+	event.is_run_when_skipped_ = true;
+	return AddCalendarEvent(MoveTemp(event));
+}
+
+int32 UTimeSystem::ScheduleHourlyEvent(int32 minute, FSimpleDelegate callback, bool is_run_when_skipped)
+{
+	if (minute < 0 || minute >= kMinutesInHour)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnNightBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnNightBegin.Broadcast();
+		throw std::invalid_argument("Invalid time of the event");
 	}
+	return ScheduleRecurringEvent(kMinutesInHour, minute, MoveTemp(callback), is_run_when_skipped);
+}
 
-	//Broadcast events on season begin
-	if (season_ == Season::Spring && day_in_season_ == 1 && hour_ == 0 && minute_ == 0)
+int32 UTimeSystem::ScheduleDailyEvent(int32 hour, int32 minute, FSimpleDelegate callback, bool is_run_when_skipped)
+{
+	if (hour < 0 || hour >= kHoursInDay || minute < 0 || minute >= kMinutesInHour)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnSpringBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnSpringBegin.Broadcast();
+		throw std::invalid_argument("Invalid time of the event");
 	}
-	else if (season_ == Season::Summer && day_in_season_ == 1 && hour_ == 0 && minute_ == 0)
+	return ScheduleRecurringEvent(kHoursInDay * kMinutesInHour, hour * kMinutesInHour + minute, MoveTemp(callback), is_run_when_skipped);
+}
+
+int32 UTimeSystem::ScheduleSeasonalEvent(int32 season, int32 day_in_season, int32 hour, int32 minute, FSimpleDelegate callback, bool is_run_when_skipped)
+{
+	if (season < -1 || season >= kSeasonsNum || day_in_season < 1 || day_in_season > kDaysInSeason
+		|| hour < 0 || hour >= kHoursInDay || minute < 0 || minute >= kMinutesInHour)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnSummerBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnSummerBegin.Broadcast();
+		throw std::invalid_argument("Invalid time of the event");
 	}
-	else if (season_ == Season::Autumn && day_in_season_ == 1 && hour_ == 0 && minute_ == 0)
+	const int64 kMinutesInSeason = static_cast<int64>(kDaysInSeason) * kHoursInDay * kMinutesInHour;
+	int64 offset = (static_cast<int64>(day_in_season - 1) * kHoursInDay + hour) * kMinutesInHour + minute;
+	if (season == -1)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnAutumnBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnAutumnBegin.Broadcast();
+		return ScheduleRecurringEvent(kMinutesInSeason, offset, MoveTemp(callback), is_run_when_skipped);
 	}
-	else if (season_ == Season::Winter && day_in_season_ == 1 && hour_ == 0 && minute_ == 0)
+	return ScheduleRecurringEvent(kMinutesInSeason * kSeasonsNum, season * kMinutesInSeason + offset, MoveTemp(callback), is_run_when_skipped);
+}
+
+void UTimeSystem::CancelEvent(int32 event)
+{
+	if (!calendar_events_.IsValidIndex(event))return;
+	//Its entry stays in the calendar and is dropped as outdated
+	calendar_events_.RemoveAt(event);
+	if (calendar_.Num() > 2 * calendar_events_.Num() + 16)RebuildCalendar();
+}
+
+int32 UTimeSystem::ScheduleRecurringEvent(int64 period, int64 offset, FSimpleDelegate callback, bool is_run_when_skipped)
+{
+	FCalendarEvent event;
+	event.callback_ = MoveTemp(callback);
+	event.period_ = period;
+	event.offset_ = offset;
+	event.due_minute_ = GetNextDueMinute(event);
+	event.is_run_when_skipped_ = is_run_when_skipped;
+	return AddCalendarEvent(MoveTemp(event));
+}
+
+int32 UTimeSystem::AddCalendarEvent(FCalendarEvent&& event)
+{
+	event.order_ = next_event_order_++;
+	int64 due_minute = event.due_minute_;
+	int32 order = event.order_;
+	int32 handle = calendar_events_.Add(MoveTemp(event));
+	calendar_.HeapPush(FCalendarEntry{ due_minute, order, handle });
+	return handle;
+}
+
+void UTimeSystem::RunDueEvents(bool is_skipping)
+{
+	while (calendar_.Num() > 0 && calendar_.HeapTop().minute_ <= present_minute_)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnWinterBegin.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnWinterBegin.Broadcast();
+		FCalendarEntry entry;
+		calendar_.HeapPop(entry, false);
+		if (!calendar_events_.IsValidIndex(entry.event_))continue;
+		FCalendarEvent& event = calendar_events_[entry.event_];
+		if (event.order_ != entry.order_ || event.due_minute_ != entry.minute_)continue;//Outdated
+
+		//The callback may schedule or cancel events, so the event is done with before it runs
+		FSimpleDelegate callback = event.callback_;
+		bool is_run = !is_skipping || event.is_run_when_skipped_;
+		if (event.period_ > 0)
+		{
+			event.due_minute_ += event.period_;
+			calendar_.HeapPush(FCalendarEntry{ event.due_minute_, event.order_, entry.event_ });
+		}
+		else
+		{
+			calendar_events_.RemoveAt(entry.event_);
+		}
+		if (is_run)callback.ExecuteIfBound();
 	}
+}
+
+int64 UTimeSystem::GetNextDueMinute(const FCalendarEvent& event) const
+{
+	int64 minutes_to_event = (event.offset_ - GetMinuteInYear() % event.period_) % event.period_;
+	if (minutes_to_event <= 0)minutes_to_event += event.period_;
+	return present_minute_ + minutes_to_event;
+}
+
+int64 UTimeSystem::GetMinuteInYear() const
+{
+	int64 day_in_year = static_cast<int64>(season_) * kDaysInSeason + (day_in_season_ - 1);
+	return (day_in_year * kHoursInDay + hour_) * kMinutesInHour + minute_;
+}
 
-	//broadcast for weather to change
-	if (hour_ == 8 && minute_ == 0)
+void UTimeSystem::RescheduleRecurringEvents()
+{
+	for (FCalendarEvent& event : calendar_events_)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInMorning.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInMorning.Broadcast();
+		if (event.period_ > 0)event.due_minute_ = GetNextDueMinute(event);
 	}
-	else if (hour_ == 20 && minute_ == 0)
+	RebuildCalendar();
+}
+
+void UTimeSystem::RebuildCalendar()
+{
+	calendar_.Reset();
+	for (auto it = calendar_events_.CreateConstIterator(); it; ++it)
 	{
-		if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInEvening.IsBound())
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInEvening.Broadcast();
+		calendar_.Add(FCalendarEntry{ it->due_minute_, it->order_, it.GetIndex() });
 	}
-
-	//UE_LOG(LogTemp, Warning, TEXT("Time now is Season: %d, Day: %d, Hour: %d, minute: %d"), static_cast<int>(get_season()), get_day_in_season(), get_hour(), get_minute());
+	calendar_.Heapify();
 }
 
 void UTimeSystem::RealTimeRecord()
@@ -1,6 +1,6 @@
 /*****************************************************************
  * \file   TimeSystem.h
- * \brief  The time system of the stardew valley. 1 minute in game is 1 second in real life.
+ * \brief  The time system of the stardew valley. The clock runs on the frame time, 1 minute in game is time_flow_speed_ seconds in real life at 1x.
  * \brief  A day is devided into early_morning, morning, noon, afternoon, evening and night.
  * \brief  A year is devided into spring, summer autumn and winter. And it's 30 days for each season.
  *
@@ -12,13 +12,14 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
 #include "TimeSystem.generated.h"
 
  /**
   *
   */
 UCLASS()
-class STARDEWVALLEY_API UTimeSystem : public UGameInstanceSubsystem
+class STARDEWVALLEY_API UTimeSystem : public UGameInstanceSubsystem, public FTickableGameObject
 {
 	GENERATED_BODY()
 private:
@@ -32,7 +33,7 @@ private:
 		Autumn,
 		Winter
 	};
-	const int kDaysInSeason = 31;
+	const int kDaysInSeason = 30;
 	const int kHoursInDay = 24;
 	const int kMinutesInHour = 60;
 	const int kSeasonsNum = 4;
@@ -42,14 +43,53 @@ private:
 	int32 hour_;
 	int32 minute_;
 
-	FTimerHandle timer_handle_;
 	FTimerHandle real_time_handle_;
 
 	UPROPERTY(VisibleAnywhere)
-	float time_flow_speed_;
+	float time_flow_speed_;//Real seconds of a game minute at 1x
+	float time_scale_;//0 pauses the time
+	float paused_time_scale_;//The time scale to resume to
+	float accumulated_time_;//Scaled real seconds that have not made a whole game minute yet
+	bool is_clock_running_;
+	const float kMaxTimeScale = 100.0f;
+	const float kMaxFrameTime = 0.25f;//A longer frame is a hitch, the rest of it is not caught up
+	const int32 kMaxMinutesPerFrame = 600;//The backlog beyond it is dropped
+
+	/**
+	 * An event on the calendar. A recurring event is due every period_ minutes, offset_ minutes into its period.
+	 * The periods are counted from 0:00 of the first day of spring.
+	 */
+	struct FCalendarEvent
+	{
+		FSimpleDelegate callback_;
+		int64 period_;//0 if the event is due only once
+		int64 offset_;
+		int64 due_minute_;//On the clock of present_minute_
+		int32 order_;//Events due at the same minute run in the order they were scheduled
+		bool is_run_when_skipped_;
+	};
+	struct FCalendarEntry
+	{
+		int64 minute_;
+		int32 order_;
+		int32 event_;
+		bool operator<(const FCalendarEntry& other) const { return minute_ != other.minute_ ? minute_ < other.minute_ : order_ < other.order_; };
+	};
+	TSparseArray<FCalendarEvent> calendar_events_;//Indexed by the handle of the event
+	TArray<FCalendarEntry> calendar_;//A min-heap on the minute, an entry is outdated if its event has been cancelled or rescheduled
+	int64 present_minute_;//Counts the game minutes since the game started
+	int32 next_event_order_;
 public:
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override { return is_clock_running_; };
+	virtual bool IsTickableWhenPaused() const override { return false; };
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
 public:
 	UTimeSystem();
 	// Getters
@@ -59,10 +99,61 @@ public:
 	int get_minute() { return minute_; }
 
 	// Setters
-	void set_season(int32 season) { season_ = static_cast<Season>(season); }
-	void set_day_in_season(int32 day_in_season) { day_in_season_ = day_in_season; }
-	void set_hour(int32 hour) { hour_ = hour; }
-	void set_minute(int32 minute) { minute_ = minute; }
+	void set_season(int32 season) { season_ = static_cast<Season>(season); RescheduleRecurringEvents(); }
+	void set_day_in_season(int32 day_in_season) { day_in_season_ = day_in_season; RescheduleRecurringEvents(); }
+	void set_hour(int32 hour) { hour_ = hour; RescheduleRecurringEvents(); }
+	void set_minute(int32 minute) { minute_ = minute; RescheduleRecurringEvents(); }
+	int64 get_present_minute() const { return present_minute_; }
+
+	/**
+	 * \brief Run the callback once after the given minutes.
+	 *
+	 * \param kDelayInMinutes The number of minutes from now, 0 runs it at the present minute if the clock is running events
+	 * \param callback The callback
+	 * \return An int32, the handle of the event
+	 * \throw invalid_argument exception when the number of minutes is negative.
+	 */
+	int32 ScheduleEventAfter(const int32 kDelayInMinutes, FSimpleDelegate callback);
+	/**
+	 * \brief Run the callback every hour at the given minute.
+	 *
+	 * \param minute The minute of the hour
+	 * \param callback The callback
+	 * \param is_run_when_skipped False if the event is only kept in step when the time is fast forwarded
+	 * \return An int32, the handle of the event
+	 * \throw invalid_argument exception when the time is out of range.
+	 */
+	int32 ScheduleHourlyEvent(int32 minute, FSimpleDelegate callback, bool is_run_when_skipped = true);
+	/**
+	 * \brief Run the callback every day at the given time, e.g. 8:00.
+	 *
+	 * \param hour The hour of the day
+	 * \param minute The minute of the hour
+	 * \param callback The callback
+	 * \param is_run_when_skipped False if the event is only kept in step when the time is fast forwarded
+	 * \return An int32, the handle of the event
+	 * \throw invalid_argument exception when the time is out of range.
+	 */
+	int32 ScheduleDailyEvent(int32 hour, int32 minute, FSimpleDelegate callback, bool is_run_when_skipped = true);
+	/**
+	 * \brief Run the callback at the given time of a season, e.g. the first minute of winter.
+	 *
+	 * \param season The season, -1 for every season
+	 * \param day_in_season The day of the season, starts from 1
+	 * \param hour The hour of the day
+	 * \param minute The minute of the hour
+	 * \param callback The callback
+	 * \param is_run_when_skipped False if the event is only kept in step when the time is fast forwarded
+	 * \return An int32, the handle of the event
+	 * \throw invalid_argument exception when the time is out of range.
+	 */
+	int32 ScheduleSeasonalEvent(int32 season, int32 day_in_season, int32 hour, int32 minute, FSimpleDelegate callback, bool is_run_when_skipped = true);
+	/**
+	 * \brief Remove the event from the calendar. Does nothing if it has run or been cancelled.
+	 *
+	 * \param event The handle of the event
+	 */
+	void CancelEvent(int32 event);
 
 	/**
 	 * \brief To have the time flow by given minutes, 1 minute by default.
@@ -72,8 +163,78 @@ public:
 	 */
 	void Flow(const int32 kElapsedTimeInMinutes = 1);
 
-	UFUNCTION()
-	void TimeFlow();
+	/**
+	 * \brief Skip the given minutes at once, e.g. sleeping. The minutes are not replayed one by one.
+	 * \brief The jump is split at the due events of the calendar, only those run when skipped are run,
+	 * \brief the crops grow each part at once and the temperature is updated for the final hour.
+	 *
+	 * \param kElapsedTimeInMinutes The number of minutes to skip.
+	 * \throw invalid_argument exception when the number of minutes is negative.
+	 */
+	void FastForward(const int32 kElapsedTimeInMinutes);
+	/**
+	 * \brief Skip to the next time of day at the given hour and minute, e.g. 6:00 to sleep until morning.
+	 *
+	 * \param hour The hour to skip to
+	 * \param minute The minute to skip to
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SkipToTime(int32 hour, int32 minute);
+
+	/**
+	 * \brief Set how fast the game time flows, e.g. 0 to pause, 1, 10 or 100. The minutes of a frame are run at once.
+	 *
+	 * \param time_scale The game minutes per time_flow_speed_ real seconds, clamped to [0, 100]
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetTimeScale(float time_scale);
+	UFUNCTION(BlueprintCallable)
+	float get_time_scale() const { return time_scale_; }
+	/**
+	 * \brief Stop the game time, ResumeTime continues with the time scale before.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void PauseTime();
+	UFUNCTION(BlueprintCallable)
+	void ResumeTime();
+	UFUNCTION(BlueprintCallable)
+	bool is_time_paused() const { return time_scale_ <= 0.0f; }
 
 	void RealTimeRecord();
+private:
+	/**
+	 * \brief Run the given minutes of the clock. The minutes are split at the due events of the calendar,
+	 * \brief the events are run in between and OnMinuteChanged is broadcast once at the end.
+	 *
+	 * \param kElapsedTimeInMinutes The number of minutes to run.
+	 * \param is_skipping True to run only the events that are run when skipped
+	 */
+	void AdvanceClock(const int32 kElapsedTimeInMinutes, bool is_skipping);
+	/**
+	 * \brief Write the present time to the data system.
+	 */
+	void SyncToDataSystem();
+	/**
+	 * \brief Put the events of the time system on the calendar, they broadcast the time events of the event system.
+	 */
+	void ScheduleTimeEvents(class UEventSystem* EventSystem);
+	int32 ScheduleRecurringEvent(int64 period, int64 offset, FSimpleDelegate callback, bool is_run_when_skipped);
+	int32 AddCalendarEvent(FCalendarEvent&& event);
+	/**
+	 * \brief Run the events due by the present minute in order. A recurring event is queued again first.
+	 */
+	void RunDueEvents(bool is_skipping);
+	/**
+	 * \brief Get the minute of the first recurring period after the present minute.
+	 */
+	int64 GetNextDueMinute(const FCalendarEvent& event) const;
+	int64 GetMinuteInYear() const;
+	/**
+	 * \brief Recompute the due minutes of the recurring events after the time has been set.
+	 */
+	void RescheduleRecurringEvents();
+	/**
+	 * \brief Rebuild the calendar from the events, dropping the outdated entries.
+	 */
+	void RebuildCalendar();
 };
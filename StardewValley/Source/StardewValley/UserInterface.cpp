@@ -21,13 +21,15 @@
 #include "Engine/Texture2D.h"
 #include "SlateBasics.h"
 #include "SlateCore.h"
-#include "Engine/DataTable.h"
 #include "Struct_ItemBase.h"
+#include "ItemRegistry.h"
 #include "Engine/StreamableManager.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
 #include "EventSystem.h"
 #include "DataSystem.h"
+#include "SaveSlotManager.h"
+#include "AssetCatalog.h"
 
 bool UUserInterface::Initialize()
 {
@@ -121,8 +123,7 @@ bool UUserInterface::Initialize()
 		int32 level = GetGameInstance()->GetSubsystem<UDataSystem>()->get_player_axe_level();
 		if (level != 0)
 		{
-			FString addr = "/Game/Asset/Icon/Ico_Item_Aex_Level" + FString::FromInt(level) + ".Ico_Item_Aex_Level" + FString::FromInt(level);
-			UTexture2D* texture2d = LoadObject<UTexture2D>(nullptr, addr.GetCharArray().GetData());
+			UTexture2D* texture2d = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetSkillIcon(1, level);
 			UImage* axe_icon = Cast<UImage>(GetWidgetFromName("ImgAxeLevel"));
 			FSlateBrush brush;
 			brush.SetResourceObject(texture2d);
@@ -131,8 +132,7 @@ bool UUserInterface::Initialize()
 		level = GetGameInstance()->GetSubsystem<UDataSystem>()->get_player_hoe_level();
 		if (level != 0)
 		{
-			FString addr = "/Game/Asset/Icon/Ico_Item_Hoe_Level" + FString::FromInt(level) + ".Ico_Item_Hoe_Level" + FString::FromInt(level);
-			UTexture2D* texture2d = LoadObject<UTexture2D>(nullptr, addr.GetCharArray().GetData());
+			UTexture2D* texture2d = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetSkillIcon(2, level);
 			UImage* hoe_icon = Cast<UImage>(GetWidgetFromName("ImgHoeLevel"));
 			FSlateBrush brush;
 			brush.SetResourceObject(texture2d);
@@ -141,8 +141,7 @@ bool UUserInterface::Initialize()
 		level = GetGameInstance()->GetSubsystem<UDataSystem>()->get_player_scythe_level();
 		if (level != 0)
 		{
-			FString addr = "/Game/Asset/Icon/Ico_Item_Scythe_Level" + FString::FromInt(level) + ".Ico_Item_Scythe_Level" + FString::FromInt(level);
-			UTexture2D* texture2d = LoadObject<UTexture2D>(nullptr, addr.GetCharArray().GetData());
+			UTexture2D* texture2d = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetSkillIcon(3, level);
 			UImage* scythe_icon = Cast<UImage>(GetWidgetFromName("ImgScytheLevel"));
 			FSlateBrush brush;
 			brush.SetResourceObject(texture2d);
@@ -165,8 +164,8 @@ bool UUserInterface::Initialize()
 		auto EventSystem = GameInstance->GetSubsystem<UEventSystem>();
 		if (EventSystem != nullptr)
 		{
-			EventSystem->OnAnExpBarFull.AddUObject(this, &UUserInterface::EnableALevelUpButton);
-			EventSystem->OnSkillExpUpdate.AddUObject(this, &UUserInterface::ExpGiver);
+			EventSystem->Subscribe(EventSystem->OnAnExpBarFull, TEXT("OnAnExpBarFull"), this, &UUserInterface::EnableALevelUpButton);
+			EventSystem->Subscribe(EventSystem->OnSkillExpUpdate, TEXT("OnSkillExpUpdate"), this, &UUserInterface::ExpGiver);
 		}
 	}
 	BtnAexUp->OnClicked.AddDynamic(this, &UUserInterface::AxeLevelUp);
@@ -215,7 +214,8 @@ void UUserInterface::ChangeInterface(int32 index)
 }
 void UUserInterface::ExitGame()
 {
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnExitGame.Broadcast();
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnExitGame);
 	UKismetSystemLibrary::QuitGame(GetWorld(), nullptr, EQuitPreference::Quit, true);
 }
 void UUserInterface::SaveGame()
@@ -226,30 +226,19 @@ void UUserInterface::ReturnToGame()
 {
 	//GetWorld()->GetFirstPlayerController()->bShowMouseCursor = false;
 	GetGameInstance()->GetFirstLocalPlayerController()->SetPause(false);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnUIMenuClosed.Broadcast();
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnUIMenuClosed);
 	RemoveFromParent();
 }
 void UUserInterface::GoodbyeWorld()
 {
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnReturnTitle.Broadcast();
-	auto GetSaveGameFilePath = [](const FString& SlotName) -> FString
-		{
-			FString SaveDirectory = FPaths::ProjectSavedDir() / TEXT("SaveGames");
-
-			FString SaveGameFileName = SlotName + TEXT(".sav");
-			FString SaveGameFilePath = SaveDirectory / SaveGameFileName;
-
-			return SaveGameFilePath;
-		};
-	FString SaveGameFilePath = GetSaveGameFilePath("SavedGame");
-	UE_LOG(LogTemp, Warning, TEXT("address : %s"), *SaveGameFilePath);
-
-	if (IFileManager::Get().FileExists(*SaveGameFilePath))
-	{
-		bool bSuccess = IFileManager::Get().Delete(*SaveGameFilePath);
-		UE_LOG(LogTemp, Warning, TEXT("Delete : %d"), bSuccess);
-	}
-	GetGameInstance()->GetSubsystem<UDataSystem>()->do_save = false;
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnReturnTitle);
+	UDataSystem* DataSystem = GetGameInstance()->GetSubsystem<UDataSystem>();
+	DataSystem->WaitForSave();//Or a save still being written brings the file back
+	DataSystem->WaitForDecode();//The file may be mapped until every chunk is decoded
+	GetGameInstance()->GetSubsystem<USaveSlotManager>()->DeleteSlot(DataSystem->get_slot_name());
+	DataSystem->do_save = false;
 	UKismetSystemLibrary::QuitGame(GetWorld(), nullptr, EQuitPreference::Quit, true);
 }
 void UUserInterface::ConfigOption()
@@ -275,7 +264,8 @@ void UUserInterface::IncreaseProgressBarValue(UProgressBar* bar, float value)
 			bar->SetPercent(1.0f);
 			if (bar->GetName() == "BarAexExp" || bar->GetName() == "BarHoeExp" || bar->GetName() == "BarScytheExp")//Exp Bar
 			{
-				GetGameInstance()->GetSubsystem<UEventSystem>()->OnAnExpBarFull.Broadcast();
+				UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+				EventSystem->BroadcastEvent(EventSystem->OnAnExpBarFull);
 			}
 		}
 		
@@ -349,8 +339,7 @@ void UUserInterface::AxeLevelUp()
 
 	//Change the icon
 	int32 level = GetGameInstance()->GetSubsystem<UDataSystem>()->get_player_axe_level();
-	FString addr = "/Game/Asset/Icon/Ico_Item_Aex_Level" + FString::FromInt(level) + ".Ico_Item_Aex_Level" + FString::FromInt(level);
-	UTexture2D* texture2d = LoadObject<UTexture2D>(nullptr, addr.GetCharArray().GetData());
+	UTexture2D* texture2d = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetSkillIcon(1, level);
 	UImage* axe_icon = Cast<UImage>(GetWidgetFromName("ImgAxeLevel"));
 	FSlateBrush brush;
 	brush.SetResourceObject(texture2d);
@@ -371,8 +360,7 @@ void UUserInterface::HoeLevelUp()
 
 	//Change the icon
 	int32 level = GetGameInstance()->GetSubsystem<UDataSystem>()->get_player_hoe_level();
-	FString addr = "/Game/Asset/Icon/Ico_Item_Hoe_Level" + FString::FromInt(level) + ".Ico_Item_Hoe_Level" + FString::FromInt(level);
-	UTexture2D* texture2d = LoadObject<UTexture2D>(nullptr, addr.GetCharArray().GetData());
+	UTexture2D* texture2d = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetSkillIcon(2, level);
 	UImage* hoe_icon = Cast<UImage>(GetWidgetFromName("ImgHoeLevel"));
 	FSlateBrush brush;
 	brush.SetResourceObject(texture2d);
@@ -393,8 +381,7 @@ void UUserInterface::ScytheLevelUp()
 
 	//Change the icon
 	int32 level = GetGameInstance()->GetSubsystem<UDataSystem>()->get_player_scythe_level();
-	FString addr = "/Game/Asset/Icon/Ico_Item_Scythe_Level" + FString::FromInt(level) + ".Ico_Item_Scythe_Level" + FString::FromInt(level);
-	UTexture2D* texture2d = LoadObject<UTexture2D>(nullptr, addr.GetCharArray().GetData());
+	UTexture2D* texture2d = GetGameInstance()->GetSubsystem<UAssetCatalog>()->GetSkillIcon(3, level);
 	UImage* scythe_icon = Cast<UImage>(GetWidgetFromName("ImgScytheLevel"));
 	FSlateBrush brush;
 	brush.SetResourceObject(texture2d);
@@ -467,8 +454,7 @@ void UUserInterface::AddItemToBag(int32 id, int32 amount)
 		TextAmount->SetRenderTranslation(FVector2D(0.0f, 14.0f));
 		TextAmount->SetText(FText::FromString(FString::FromInt(ItemsInBag[id])));
 
-		UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBase.DT_ItemBase"));
-		FStruct_ItemBase* item_info = item_data_table->FindRow<FStruct_ItemBase>(FName(*FString::FromInt(id)), "");
+		const FStruct_ItemBase* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemInfo(id);
 		FName image_name = FName("Image" + FString::FromInt(id));
 		UImage* Image = NewObject<UImage>(GetWorld(), UImage::StaticClass(), image_name);
 		if (item_info != nullptr)
@@ -481,7 +467,7 @@ void UUserInterface::AddItemToBag(int32 id, int32 amount)
 		}
 		else
 		{
-			UTexture2D* texture = LoadObject<UTexture2D>(nullptr, TEXT("Texture2D'/Game/Asset/Icon/Ico_Test_4oD.Ico_Test_4oD'"));
+			UTexture2D* texture = GetGameInstance()->GetSubsystem<UAssetCatalog>()->Get<UTexture2D>(EAssetKey::MissingIcon);
 			FSlateBrush brush;
 			brush.SetResourceObject(texture);
 			Image->SetBrush(brush);
@@ -542,8 +528,7 @@ void UUserInterface::OnItemSelected(int32 id)
 	if (item_selected_ != -1) OnItemDeselected();
 	item_selected_ = id;
 
-	UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBase.DT_ItemBase"));
-	FStruct_ItemBase* item_info = item_data_table->FindRow<FStruct_ItemBase>(FName(*FString::FromInt(id)), "");
+	const FStruct_ItemBase* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemInfo(id);
 
 	FName image_icon_name = FName("ImageIcon" + FString::FromInt(id));
 	UImage* image_icon = NewObject<UImage>(GetWorld(), UImage::StaticClass(), image_icon_name);
@@ -557,7 +542,7 @@ void UUserInterface::OnItemSelected(int32 id)
 	}
 	else
 	{
-		UTexture2D* texture = LoadObject<UTexture2D>(nullptr, TEXT("Texture2D'/Game/Asset/Icon/Ico_Test_4oD.Ico_Test_4oD'"));
+		UTexture2D* texture = GetGameInstance()->GetSubsystem<UAssetCatalog>()->Get<UTexture2D>(EAssetKey::MissingIcon);
 		FSlateBrush brush;
 		brush.SetResourceObject(texture);
 		image_icon->SetBrush(brush);
@@ -589,7 +574,7 @@ void UUserInterface::OnShortcutSelected(int32 index)
 		if (image != nullptr && image->GetName().Left(16) == "ShortcutItemIcon")//Remove it.
 		{
 			button->SetRenderScale(FVector2D(3.5f, 2.5f));
-			UTexture2D* texture = LoadObject<UTexture2D>(nullptr, TEXT("Texture2D'/Game/Asset/Icon/Ico_Axe_Level1.Ico_Axe_Level1'"));
+			UTexture2D* texture = GetGameInstance()->GetSubsystem<UAssetCatalog>()->Get<UTexture2D>(EAssetKey::EmptyShortcutIcon);
 			FSlateBrush brush;
 			brush.SetResourceObject(texture);
 			image->SetBrush(brush);
@@ -599,7 +584,8 @@ void UUserInterface::OnShortcutSelected(int32 index)
 			const TCHAR* the_new_name = new_name.GetCharArray().GetData();
 			image->Rename(the_new_name);
 
-			GetGameInstance()->GetSubsystem<UEventSystem>()->OnItemRemovedFromShortcutBar.Broadcast(index);
+			UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+			EventSystem->BroadcastEvent(EventSystem->OnItemRemovedFromShortcutBar, index);
 		}
 	}
 	else//Add it.
@@ -609,8 +595,7 @@ void UUserInterface::OnShortcutSelected(int32 index)
 		const TCHAR* the_new_name = new_name.GetCharArray().GetData();
 		image->Rename(the_new_name);
 
-		UDataTable* item_data_table = LoadObject<UDataTable>(nullptr, TEXT("/Game/Datatable/DT_ItemBase.DT_ItemBase"));
-		FStruct_ItemBase* item_info = item_data_table->FindRow<FStruct_ItemBase>(FName(*FString::FromInt(item_selected_)), "");
+		const FStruct_ItemBase* item_info = GetGameInstance()->GetSubsystem<UItemRegistry>()->GetItemInfo(item_selected_);
 		if (item_info != nullptr)
 		{
 			UTexture2D* texture = item_info->icon_;
@@ -621,13 +606,14 @@ void UUserInterface::OnShortcutSelected(int32 index)
 		}
 		else
 		{
-			UTexture2D* texture = LoadObject<UTexture2D>(nullptr, TEXT("Texture2D'/Game/Asset/Icon/Ico_Test_4oD.Ico_Test_4oD'"));
+			UTexture2D* texture = GetGameInstance()->GetSubsystem<UAssetCatalog>()->Get<UTexture2D>(EAssetKey::MissingIcon);
 			FSlateBrush brush;
 			brush.SetResourceObject(texture);
 			image->SetBrush(brush);
 			image->SetBrushSize(FVector2D(20.0, 30.0));
 		}
-		GetGameInstance()->GetSubsystem<UEventSystem>()->OnItemAddedToShortcutBar.Broadcast(item_selected_, index);
+		UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+		EventSystem->BroadcastEvent(EventSystem->OnItemAddedToShortcutBar, item_selected_, index);
 		OnItemDeselected();
 	}
 }
@@ -17,19 +17,20 @@ void UWeatherSystem::Initialize(FSubsystemCollectionBase& Collection)
 	Super::Initialize(Collection);
 	srand(time(nullptr));
 
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
 	//Weather change
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInMorning.AddUObject(this, &UWeatherSystem::ChangeWeather);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInEvening.AddUObject(this, &UWeatherSystem::ChangeWeather);
+	EventSystem->Subscribe(EventSystem->OnEightInMorning, TEXT("OnEightInMorning"), this, &UWeatherSystem::ChangeWeather);
+	EventSystem->Subscribe(EventSystem->OnEightInEvening, TEXT("OnEightInEvening"), this, &UWeatherSystem::ChangeWeather);
 
 	//Temperature change
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnHourChanged.AddUObject(this, &UWeatherSystem::UpdateBaseTemperature);
+	EventSystem->Subscribe(EventSystem->OnHourChanged, TEXT("OnHourChanged"), this, &UWeatherSystem::UpdateBaseTemperature);
 }
 
 void UWeatherSystem::Deinitialize()
 {
 	Super::Deinitialize();
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInMorning.RemoveAll(this);
-	GetGameInstance()->GetSubsystem<UEventSystem>()->OnEightInEvening.RemoveAll(this);
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	if (EventSystem)EventSystem->UnsubscribeAll(this);
 }
 
 void UWeatherSystem::ChangeWeather()
@@ -69,8 +70,8 @@ void UWeatherSystem::ChangeWeather()
 
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_present_weather(current_weather);//datasystem update
 	weather_ = static_cast<Weather>(current_weather);
-	if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnWeatherChanged.IsBound())
-		GetGameInstance()->GetSubsystem<UEventSystem>()->OnWeatherChanged.Broadcast();//broadcast
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnWeatherChanged);//broadcast
 
 	//UE_LOG(LogTemp, Warning, TEXT("Weather changed to %d"), static_cast<int32>(weather_));
 }
@@ -159,7 +160,7 @@ void UWeatherSystem::UpdateBaseTemperature()
 	}
 
 	GetGameInstance()->GetSubsystem<UDataSystem>()->set_present_base_temperature(base_temperature);//datasystem update
-	if (GetGameInstance()->GetSubsystem<UEventSystem>()->OnBaseTemperatureChanged.IsBound())
-		GetGameInstance()->GetSubsystem<UEventSystem>()->OnBaseTemperatureChanged.Broadcast();//broadcast
+	UEventSystem* EventSystem = GetGameInstance()->GetSubsystem<UEventSystem>();
+	EventSystem->BroadcastEvent(EventSystem->OnBaseTemperatureChanged);//broadcast
 	//UE_LOG(LogTemp, Warning, TEXT("Base temperature updated to %d"), base_temperature);
 }
\ No newline at end of file